@@ -0,0 +1,306 @@
+// Guards the hot paths against allocation regressions. This test has an
+// executable of its own, since it replaces the global operator new and
+// delete to count the allocations made within an AllocationScope.
+//
+// Budgets are per token, per node or per expansion, so that a change
+// that adds an allocation to every one of them fails, while constant
+// costs (e.g. growing a reused buffer) stay below them.
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "buffer_tokenizer.h"
+#include "gtest/gtest.h"
+#include "parser.h"
+#include "tokenizer.h"
+#include "tool/macro.h"
+#include "util/arena.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+namespace {
+// Only the allocations of the thread that opened a scope are counted.
+thread_local bool counting = false;
+thread_local size_t num_allocations = 0;
+thread_local size_t num_bytes = 0;
+
+void *Allocate(size_t size, size_t alignment) {
+  if (counting) {
+    ++num_allocations;
+    num_bytes += size;
+  }
+  if (size == 0) size = 1;
+  void *memory = nullptr;
+  if (alignment <= alignof(std::max_align_t)) {
+    memory = std::malloc(size);
+  } else {
+    // aligned_alloc wants a multiple of the alignment.
+    memory = std::aligned_alloc(alignment,
+                                (size + alignment - 1) / alignment * alignment);
+  }
+  return memory;
+}
+
+// Counts the allocations made from its construction to its destruction.
+// Scopes do not nest.
+class AllocationScope {
+ public:
+  AllocationScope() {
+    num_allocations = 0;
+    num_bytes = 0;
+    counting = true;
+  }
+
+  ~AllocationScope() {
+    counting = false;
+  }
+
+  size_t allocations() const {
+    return num_allocations;
+  }
+
+  size_t bytes() const {
+    return num_bytes;
+  }
+
+ private:
+  AllocationScope(const AllocationScope&) = delete;
+  const AllocationScope &operator=(const AllocationScope&) = delete;
+};
+
+// Expects at most budget allocations per unit of work on average, and
+// records the figures in the test report.
+void ExpectBudget(const AllocationScope &scope, const char *unit,
+                  size_t count, double budget) {
+  double allocations = static_cast<double>(scope.allocations()) / count;
+  double bytes = static_cast<double>(scope.bytes()) / count;
+  testing::Test::RecordProperty(std::string("allocations_per_") + unit,
+                                std::to_string(allocations));
+  testing::Test::RecordProperty(std::string("bytes_per_") + unit,
+                                std::to_string(bytes));
+  EXPECT_LE(allocations, budget)
+      << scope.allocations() << " allocations for " << count << " "
+      << unit << "s";
+}
+
+std::string Repeat(const std::string &code, size_t times) {
+  std::string result;
+  for (size_t i = 0; i < times; ++i) {
+    result += code;
+  }
+  return result;
+}
+
+constexpr size_t REPEATS = 1000;
+const std::string FORM =
+    "(Defun :Key (x \"a string that does not fit inline\") 12 -3.5 ,y)\n";
+constexpr size_t TOKENS_PER_FORM = 12;
+constexpr size_t NODES_PER_FORM = 9;
+}  // namespace
+
+}  // namespace lisparser
+
+void *operator new(size_t size) {
+  void *memory = lisparser::Allocate(size, alignof(std::max_align_t));
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+  return lisparser::Allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return lisparser::Allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  void *memory = lisparser::Allocate(size, static_cast<size_t>(alignment));
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+namespace lisparser {
+
+TEST(Allocation, ScopeTest) {
+  AllocationScope scope;
+  std::unique_ptr<int> one(new int(1));
+  std::vector<char> many(100);
+  EXPECT_EQ(2, scope.allocations());
+  EXPECT_EQ(sizeof(int) + 100, scope.bytes());
+}
+
+TEST(Allocation, BufferTokenizerTest) {
+  std::string code = Repeat(FORM, REPEATS);
+  BufferTokenizer tokenizer(code.data(), code.size());
+
+  AllocationScope scope;
+  // Bounded, so that a tokenizer that stops advancing fails instead of
+  // hanging (e.g. a read left inside an assert() in a Release build).
+  size_t num_tokens = 0;
+  while (num_tokens <= TOKENS_PER_FORM * REPEATS &&
+         tokenizer.Next().type != Token::TERMINATOR) {
+    ++num_tokens;
+  }
+  ASSERT_EQ(TOKENS_PER_FORM * REPEATS, num_tokens);
+  // Only the buffer for rewritten tokens grows, a few times.
+  ExpectBudget(scope, "token", num_tokens, 0.01);
+}
+
+TEST(Allocation, StreamTokenizerTest) {
+  std::string code = Repeat(FORM, REPEATS);
+  Tokenizer tokenizer(code);
+
+  AllocationScope scope;
+  // Bounded, so that a tokenizer that stops advancing fails instead of
+  // hanging (e.g. a read left inside an assert() in a Release build).
+  size_t num_tokens = 0;
+  while (num_tokens <= TOKENS_PER_FORM * REPEATS &&
+         tokenizer.Next().type != Token::TERMINATOR) {
+    ++num_tokens;
+  }
+  ASSERT_EQ(TOKENS_PER_FORM * REPEATS, num_tokens);
+  // Only the values longer than the small string buffer allocate.
+  ExpectBudget(scope, "token", num_tokens, 0.25);
+}
+
+TEST(Allocation, ParserTest) {
+  std::string code = Repeat(FORM, REPEATS);
+  Parser parser(new BufferTokenizer(code.data(), code.size()));
+  std::vector<AST> forms;
+  forms.reserve(REPEATS);
+
+  AllocationScope scope;
+  for (auto form = parser.Next(); form.ok(); form = parser.Next()) {
+    forms.push_back(std::move(form.value()));
+  }
+  ASSERT_EQ(REPEATS, forms.size());
+  // Lists allocate their node and children (growing as they are
+  // pushed), and long strings their content.
+  ExpectBudget(scope, "node", NODES_PER_FORM * REPEATS, 1.25);
+}
+
+TEST(Allocation, ArenaParserTest) {
+  std::string code = Repeat(FORM, REPEATS);
+  util::Arena arena;
+  Parser parser(new BufferTokenizer(code.data(), code.size()));
+  parser.set_arena(&arena);
+  std::vector<AST> forms;
+  forms.reserve(REPEATS);
+
+  AllocationScope scope;
+  for (auto form = parser.Next(); form.ok(); form = parser.Next()) {
+    forms.push_back(std::move(form.value()));
+  }
+  ASSERT_EQ(REPEATS, forms.size());
+  // Everything comes from the arena, which only allocates blocks.
+  ExpectBudget(scope, "node", NODES_PER_FORM * REPEATS, 0.01);
+}
+
+TEST(Allocation, PushTest) {
+  AST list = AST::Vector();
+  AllocationScope scope;
+  for (int i = 0; i < 1024; ++i) {
+    list.Push(AST::Integer(i));
+  }
+  // The children grow geometrically.
+  ExpectBudget(scope, "node", 1024, 0.02);
+}
+
+TEST(Allocation, ResultTest) {
+  AllocationScope scope;
+  for (int i = 0; i < 100; ++i) {
+    util::Result<AST> value(AST::Integer(i));
+    util::Result<AST> error(ParserBase::EMPTY, "a literal message");
+    util::Result<size_t> count(static_cast<size_t>(i));
+    util::Result<AST> moved(std::move(error));
+    util::Result<bool> converted = util::Result<bool>::ErrorFrom(
+        std::move(moved));
+  }
+  EXPECT_EQ(0, scope.allocations());
+}
+
+// Engine::Evaluate on owned forms, with and without macro calls.
+TEST(Allocation, EvaluateTest) {
+  macro::Engine engine;
+  ASSERT_TRUE(engine.Acquire(Parser("(defmacro :m (a b) (f ,a (g ,b) ,b))")
+                             .Next().value()).ok());
+  std::string code = Repeat("(h (:m x (y 1)) (z 2 3) (w))\n", REPEATS);
+  std::vector<AST> forms;
+  Parser parser(code);
+  for (auto form = parser.Next(); form.ok(); form = parser.Next()) {
+    forms.push_back(std::move(form.value()));
+  }
+  std::vector<AST> plain;
+  Parser plain_parser(Repeat("(h (x (y 1)) (z 2 3) (w))\n", REPEATS));
+  for (auto form = plain_parser.Next(); form.ok();
+       form = plain_parser.Next()) {
+    plain.push_back(std::move(form.value()));
+  }
+
+  {
+    AllocationScope scope;
+    for (AST &form : forms) {
+      auto result = engine.Evaluate(std::move(form));
+      ASSERT_TRUE(result.ok());
+    }
+    // The stack of the template, the node and the children of the two
+    // lists of the body, and of the copy of the argument used twice.
+    ExpectBudget(scope, "expansion", REPEATS, 8);
+  }
+  {
+    // Forms without macro calls are returned as they are.
+    AllocationScope scope;
+    for (AST &form : plain) {
+      auto result = engine.Evaluate(std::move(form));
+      ASSERT_TRUE(result.ok());
+    }
+    EXPECT_EQ(0, scope.allocations());
+  }
+}
+
+}  // namespace lisparser
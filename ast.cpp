@@ -1,6 +1,8 @@
 #include "ast.h"
 
 #include <cmath>
+#include <cstring>
+#include "serializer.h"
 #include "token.h"
 
 namespace lisparser {
@@ -9,40 +11,74 @@ namespace {
 constexpr double EPSILON_FOR_FLOAT_COMPARISON = 1e-6;
 }
 
-AST AST::Keyword(std::string &&name) {
-  return AST(AST::KEYWORD,
-             ValuePointer(new std::string(std::move(name)),
-                          &internal::DefaultDelete<std::string>));
+static_assert(sizeof(AST) <= 24, "AST nodes are supposed to be compact.");
+
+AST AST::Keyword(SymbolId name) {
+  AST result(AST::KEYWORD);
+  result._symbol = name;
+  return result;
 }
 
-AST AST::Symbol(std::string &&name) {
-  return AST(AST::SYMBOL,
-             ValuePointer(new std::string(std::move(name)),
-                          &internal::DefaultDelete<std::string>));
+AST AST::Symbol(SymbolId name) {
+  AST result(AST::SYMBOL);
+  result._symbol = name;
+  return result;
 }
 
-AST AST::String(std::string &&content) {
-  return AST(AST::STRING,
-             ValuePointer(new std::string(std::move(content)),
-                          &internal::DefaultDelete<std::string>));
+AST AST::EvalForm(SymbolId variable) {
+  AST result(AST::EVAL_FORM);
+  result._symbol = variable;
+  return result;
 }
 
-AST AST::EvalForm(std::string &&variable) {
-  return AST(AST::EVAL_FORM,
-             ValuePointer(new std::string(std::move(variable)),
-                          &internal::DefaultDelete<std::string>));
+AST AST::String(std::string_view content,
+                std::pmr::memory_resource *resource) {
+  AST result(AST::STRING);
+  if (content.size() <= SMALL_STRING_CAPACITY) {
+    std::memcpy(result._small, content.data(), content.size());
+    result._small_size = static_cast<uint8_t>(content.size());
+  } else {
+    void *memory = resource->allocate(sizeof(std::pmr::string),
+                                      alignof(std::pmr::string));
+    result._string = new (memory) std::pmr::string(content, resource);
+    result._small_size = LARGE_STRING;
+  }
+  return result;
 }
 
 AST AST::Integer(int64_t value) {
-  return AST(AST::INTEGER,
-             ValuePointer(new int64_t(value),
-                          &internal::DefaultDelete<int64_t>));
+  AST result(AST::INTEGER);
+  result._integer = value;
+  return result;
 }
 
 AST AST::Double(double value) {
-  return AST(AST::FLOAT,
-             ValuePointer(new double(value),
-                          &internal::DefaultDelete<double>));
+  AST result(AST::FLOAT);
+  result._double = value;
+  return result;
+}
+
+AST AST::Vector(std::pmr::memory_resource *resource) {
+  AST result(AST::LIST);
+  void *memory = resource->allocate(sizeof(List), alignof(List));
+  result._vector.list = new (memory) List(resource);
+  result._vector.heads = 0;
+  return result;
+}
+
+void AST::Destroy() {
+  if (_type == LIST) {
+    std::pmr::memory_resource *resource =
+        _vector.list->get_allocator().resource();
+    _vector.list->~List();
+    resource->deallocate(_vector.list, sizeof(List), alignof(List));
+  } else if (_type == STRING && _small_size == LARGE_STRING) {
+    std::pmr::memory_resource *resource =
+        _string->get_allocator().resource();
+    _string->~basic_string();
+    resource->deallocate(_string, sizeof(std::pmr::string),
+                         alignof(std::pmr::string));
+  }
 }
 
 bool AST::operator==(const AST&other) const {
@@ -51,8 +87,10 @@ bool AST::operator==(const AST&other) const {
   switch (_type) {
     case SYMBOL:
     case KEYWORD:
-    case STRING:
     case EVAL_FORM:
+      return _symbol == other._symbol;
+
+    case STRING:
       return AsString() == other.AsString();
 
     case FLOAT:
@@ -71,19 +109,19 @@ bool AST::operator==(const AST&other) const {
   return false;
 }
 
-AST AST::Copy() const {
+AST AST::Copy(std::pmr::memory_resource *resource) const {
   switch (type()) {
     case AST::KEYWORD:
-      return Keyword(std::string(AsString()));
+      return Keyword(_symbol);
 
     case AST::SYMBOL:
-      return Symbol(std::string(AsString()));
+      return Symbol(_symbol);
 
     case AST::STRING:
-      return String(std::string(AsString()));
+      return String(AsString(), resource);
 
     case AST::EVAL_FORM:
-      return EvalForm(std::string(AsString()));
+      return EvalForm(_symbol);
 
     case AST::INTEGER:
       return Integer(AsInt64());
@@ -92,53 +130,22 @@ AST AST::Copy() const {
       return Double(AsDouble());
 
     case AST::LIST: {
-      AST result = Vector();
+      AST result = Vector(resource);
+      result.Reserve(AsVector().size());
       for (const AST &element : AsVector()) {
-        result.Push(element.Copy());
+        result.Push(element.Copy(resource));
       }
       return result;
     }
   }
+
+  // Unreachable, see operator==.
+  return Vector(resource);
 }
 
 std::ostream &operator<<(std::ostream &output, const AST &ast) {
-  switch (ast.type()) {
-    case AST::KEYWORD:
-    case AST::SYMBOL:
-      output << ast.AsString();
-      break;
-
-    case AST::STRING:
-      output << '"' << ast.AsString() << '"';
-      break;
-
-    case AST::EVAL_FORM:
-      output << ',' << ast.AsString();
-      break;
-
-    case AST::INTEGER:
-      output << ast.AsInt64();
-      break;
-      
-    case AST::FLOAT:
-      output << ast.AsDouble();
-      break;
-
-    case AST::LIST: {
-      const std::vector<AST> &elements = ast.AsVector();
-      output << '(';
-      bool first = true;
-      for (const AST &element : elements) {
-        if (!first) output << ' ';
-        output << element;
-        first = false;
-      }
-      output << ')';
-      break;
-    }
-  }
-  
-  return output;
+  // The same code as the serializer writes, which reads back.
+  return output << Serialize(ast);
 }
 
 }  // namespace lisparser
@@ -1,26 +1,30 @@
 #pragma once
 
 #include <cassert>
-#include <functional>
+#include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "symbol.h"
 
 namespace lisparser {
-namespace internal {
-template <typename AnyType>
-void DefaultDelete(void *target) {
-  std::default_delete<AnyType>()(reinterpret_cast<AnyType*>(target));
-}
-}  // namespace internal
 
+// AST is a tagged union. Integers, doubles, short strings and interned
+// names (of symbols, keywords and eval forms) are stored inline, so that
+// the most common nodes need no allocation at all. Long strings and
+// lists of children are allocated from a std::pmr::memory_resource,
+// which defaults to the global default resource. Pass a util::Arena to
+// have a whole document live in one arena that is freed in one step.
 class AST {
  public:
-  using ValuePointer = std::unique_ptr<void, std::function<void(void*)>>;
+  using List = std::pmr::vector<AST>;
 
-  enum Type {
+  enum Type : uint8_t {
     LIST = 100,
     EVAL_FORM = 101,
     KEYWORD = 0,
@@ -30,34 +34,55 @@ class AST {
     INTEGER = 4,
   };
 
-  AST(Type type, ValuePointer &&value)
-      : _type(type), _value(std::move(value)) {}
-
-  AST(AST &&other)
-      : _type(other._type), _value(std::move(other._value)) {}
+  AST(AST &&other) noexcept {
+    MoveFrom(&other);
+  }
 
-  AST &operator=(AST &&other) {
-    _type = other._type;
-    _value = std::move(other._value);
+  // other may live inside this node (e.g. be one of its children), so
+  // it is taken over before this node's storage is freed.
+  AST &operator=(AST &&other) noexcept {
+    if (this != &other) {
+      AST taken(std::move(other));
+      Destroy();
+      MoveFrom(&taken);
+    }
     return *this;
   }
+
+  ~AST() {
+    Destroy();
+  }
   
   void Swap(AST &&other) {
-    _type = other._type;
-    _value = std::move(other._value);
+    *this = std::move(other);
+  }
+
+  static AST Keyword(SymbolId name);
+  static AST Symbol(SymbolId name);
+  static AST EvalForm(SymbolId variable);
+
+  static AST Keyword(std::string_view name) {
+    return Keyword(SymbolId::Intern(name));
   }
 
-  static AST Keyword(std::string &&name);
-  static AST Symbol(std::string &&name);
-  static AST String(std::string &&content);
-  static AST EvalForm(std::string &&variable);
+  static AST Symbol(std::string_view name) {
+    return Symbol(SymbolId::Intern(name));
+  }
+
+  static AST EvalForm(std::string_view variable) {
+    return EvalForm(SymbolId::Intern(variable));
+  }
+
+  static AST String(std::string_view content,
+                    std::pmr::memory_resource *resource =
+                    std::pmr::get_default_resource());
   static AST Integer(int64_t value);
   static AST Double(double value);
-  
+
+  static AST Vector(std::pmr::memory_resource *resource);
+
   static AST Vector() {
-    return AST(AST::LIST, ValuePointer(
-        new std::vector<AST>(),
-        &internal::DefaultDelete<std::vector<AST>>));
+    return Vector(std::pmr::get_default_resource());
   }
   
   template <typename... MoreAST>
@@ -75,44 +100,130 @@ class AST {
 
   void Push(AST &&element) {
     assert(_type == LIST);
-    reinterpret_cast<std::vector<AST>*>(_value.get())->push_back(
-        std::move(element));
+    if (element._type == LIST) {
+      _vector.heads |= element._vector.heads;
+    } else if (element._type == KEYWORD && _vector.list->empty()) {
+      _vector.heads |= HeadBit(element._symbol);
+    }
+    _vector.list->push_back(std::move(element));
   }
   
-  const std::string &AsString() const {
-    return *reinterpret_cast<std::string*>(_value.get());
+  // Makes room for that many children, so that pushing them does not
+  // reallocate the list.
+  void Reserve(size_t capacity) {
+    assert(_type == LIST);
+    _vector.list->reserve(capacity);
+  }
+
+  // Also returns the names of symbols, keywords and eval forms.
+  std::string_view AsString() const {
+    if (_type != STRING) return _symbol.name();
+    if (_small_size == LARGE_STRING) return *_string;
+    return std::string_view(_small, _small_size);
+  }
+
+  // Only for symbols, keywords and eval forms.
+  SymbolId AsSymbol() const {
+    assert(_type != STRING && IsStringType());
+    return _symbol;
   }
   
   double AsDouble() const {
-    return *reinterpret_cast<double*>(_value.get());
+    return _double;
   }
 
   int64_t AsInt64() const {
-    return *reinterpret_cast<int64_t*>(_value.get());
+    return _integer;
   }
 
-  const std::vector<AST> &AsVector() const {
-    return *reinterpret_cast<std::vector<AST>*>(_value.get());
+  const List &AsVector() const {
+    return *_vector.list;
   }
 
-  std::vector<AST> ReleaseVector() {
-    std::vector<AST> released_vector;
-    released_vector.swap(
-        *reinterpret_cast<std::vector<AST>*>(_value.get()));
+  // Lets the children be rewritten in place. Since they can become
+  // anything, the list then claims every head keyword, until
+  // RecomputeHeads() is called.
+  List *MutableVector() {
+    assert(_type == LIST);
+    _vector.heads = ~HeadSet(0);
+    return _vector.list;
+  }
+
+  // Computes the head keywords from the children again, e.g. once they
+  // have been rewritten through MutableVector().
+  void RecomputeHeads() {
+    assert(_type == LIST);
+    _vector.heads = 0;
+    for (const AST &element : *_vector.list) {
+      _vector.heads |= element.heads();
+    }
+    if (!_vector.list->empty() && (*_vector.list)[0]._type == KEYWORD) {
+      _vector.heads |= HeadBit((*_vector.list)[0]._symbol);
+    }
+  }
+
+  // The released list keeps the memory resource of this node.
+  List ReleaseVector() {
+    List released_vector(_vector.list->get_allocator());
+    released_vector.swap(*_vector.list);
+    _vector.heads = 0;
     return released_vector;
   }
 
   const AST &car() const {
     assert(_type == LIST);
-    return (*reinterpret_cast<std::vector<AST>*>(_value.get()))[0];
+    return (*_vector.list)[0];
   }
 
-  AST Copy() const;
+  // A HeadSet is a 64-bit Bloom filter of keywords with one bit per
+  // keyword. Every list keeps the set of the keywords at the head of
+  // itself and of all the lists below it, which is maintained by Push().
+  // Sets that do not intersect have no keyword in common, so e.g. a
+  // subtree whose set misses the bits of all the macros contains no
+  // macro call.
+  using HeadSet = uint64_t;
+
+  static HeadSet HeadBit(SymbolId keyword) {
+    // The top bits of a multiplicative hash are the well mixed ones.
+    return HeadSet(1) << ((keyword.hash() * 0x9e3779b97f4a7c15ULL) >> 58);
+  }
+
+  // Empty for anything but lists.
+  HeadSet heads() const {
+    return _type == LIST ? _vector.heads : 0;
+  }
+
+  AST Copy(std::pmr::memory_resource *resource =
+           std::pmr::get_default_resource()) const;
   
  private:
+  // Strings up to this length are stored inline.
+  static constexpr size_t SMALL_STRING_CAPACITY = 16;
+  // Value of _small_size for strings that live in _string.
+  static constexpr uint8_t LARGE_STRING = 0xff;
+
+  explicit AST(Type type) : _integer(0), _type(type), _small_size(0) {}
+
   AST(const AST &other) = delete;
   AST &operator=(const AST &other) = delete;
 
+  inline bool IsStringType() const {
+    return _type == KEYWORD || _type == SYMBOL ||
+        _type == STRING || _type == EVAL_FORM;
+  }
+
+  // Takes over the payload of other and leaves it as a trivially
+  // destructible node.
+  void MoveFrom(AST *other) {
+    _type = other->_type;
+    _small_size = other->_small_size;
+    std::memcpy(_small, other->_small, SMALL_STRING_CAPACITY);
+    other->_type = INTEGER;
+    other->_small_size = 0;
+  }
+
+  void Destroy();
+
   static AST ConstructVector(AST &&container, AST&& last) {
     container.Push(std::move(last));
     return std::move(container);
@@ -126,8 +237,19 @@ class AST {
                            std::move(rest)...);
   }
 
+  union {
+    int64_t _integer;
+    double _double;
+    char _small[SMALL_STRING_CAPACITY];
+    SymbolId _symbol;
+    std::pmr::string *_string;
+    struct {
+      List *list;
+      HeadSet heads;
+    } _vector;
+  };
   Type _type;
-  ValuePointer _value;
+  uint8_t _small_size;
 };
 
 std::ostream &operator<<(std::ostream &output, const AST &ast);
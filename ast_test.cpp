@@ -1,6 +1,7 @@
 #include "ast.h"
 
 #include "gtest/gtest.h"
+#include "util/arena.h"
 
 namespace lisparser {
 
@@ -18,4 +19,65 @@ TEST(AST, CopyTest) {
   
   EXPECT_EQ(ast, ast.Copy());
 }
+
+TEST(AST, CompactLayoutTest) {
+  EXPECT_LE(sizeof(AST), 24);
+
+  AST moved = AST::Symbol("short-symbol");
+  AST target = std::move(moved);
+  EXPECT_EQ(AST::Symbol("short-symbol"), target);
+
+  target = AST::String("a string that is too long to be stored inline");
+  EXPECT_EQ("a string that is too long to be stored inline",
+            target.AsString());
+}
+
+TEST(AST, CopyToArenaTest) {
+  AST ast = AST::Vector(
+      AST::Keyword(":abc"),
+      AST::Vector(AST::String("xyz"), AST::Double(4.18)));
+
+  util::Arena arena;
+  AST copy = ast.Copy(&arena);
+  EXPECT_EQ(ast, copy);
+  EXPECT_EQ(&arena, copy.AsVector().get_allocator().resource());
+  EXPECT_EQ(&arena, copy.AsVector()[1].AsVector().get_allocator().resource());
+}
+
+TEST(AST, AssignOwnChildTest) {
+  AST node = AST::Vector(
+      AST::Vector(AST::String("a string that is too long to be stored inline"),
+                  AST::Integer(1)),
+      AST::Symbol("rest"));
+  node = std::move((*node.MutableVector())[0]);
+  EXPECT_EQ(AST::Vector(
+      AST::String("a string that is too long to be stored inline"),
+      AST::Integer(1)), node);
+
+  node.Swap(std::move((*node.MutableVector())[0]));
+  EXPECT_EQ(AST::String("a string that is too long to be stored inline"),
+            node);
+}
+
+TEST(AST, HeadsTest) {
+  AST::HeadSet abc = AST::HeadBit(SymbolId::Intern(":abc"));
+  AST::HeadSet xyz = AST::HeadBit(SymbolId::Intern(":xyz"));
+
+  // Only keywords at the head of a list count.
+  AST ast = AST::Vector(
+      AST::Keyword(":abc"),
+      AST::Vector(AST::Symbol("f"), AST::Keyword(":late")),
+      AST::Vector(AST::Symbol("g"), AST::Vector(AST::Keyword(":xyz"))));
+  EXPECT_EQ(abc | xyz, ast.heads());
+  EXPECT_EQ(0, ast.AsVector()[1].heads());
+  EXPECT_EQ(xyz, ast.AsVector()[2].heads());
+  EXPECT_EQ(0, AST::Keyword(":abc").heads());
+
+  EXPECT_EQ(ast.heads(), ast.Copy().heads());
+  AST moved = std::move(ast);
+  EXPECT_EQ(abc | xyz, moved.heads());
+
+  moved.ReleaseVector();
+  EXPECT_EQ(0, moved.heads());
+}
 }  // namespace lisparser
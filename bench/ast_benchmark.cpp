@@ -0,0 +1,100 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "parser.h"
+#include "serializer.h"
+
+namespace lisparser {
+namespace bench {
+
+namespace {
+constexpr size_t CORPUS_SIZE = 1 << 20;
+
+std::vector<AST> ParseCorpus() {
+  std::string code = GenerateTrees(4, 8, CORPUS_SIZE);
+  std::vector<AST> forms;
+  Parser parser(code);
+  for (auto form = parser.Next(); form.ok(); form = parser.Next()) {
+    forms.push_back(std::move(form.value()));
+  }
+  return forms;
+}
+
+void ReportNodes(benchmark::State *state, const std::vector<AST> &forms) {
+  size_t num_nodes = 0;
+  for (const AST &form : forms) {
+    num_nodes += CountNodes(form);
+  }
+  state->counters["nodes"] = benchmark::Counter(
+      static_cast<double>(num_nodes),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+}  // namespace
+
+void BM_Copy(benchmark::State &state) {
+  std::vector<AST> forms = ParseCorpus();
+  for (auto _ : state) {
+    for (const AST &form : forms) {
+      AST copy = form.Copy();
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+  ReportNodes(&state, forms);
+}
+
+void BM_Equal(benchmark::State &state) {
+  std::vector<AST> forms = ParseCorpus();
+  std::vector<AST> copies;
+  for (const AST &form : forms) {
+    copies.push_back(form.Copy());
+  }
+
+  for (auto _ : state) {
+    bool equal = true;
+    for (size_t i = 0; i < forms.size(); ++i) {
+      equal = equal && forms[i] == copies[i];
+    }
+    benchmark::DoNotOptimize(equal);
+  }
+  ReportNodes(&state, forms);
+}
+
+void BM_Print(benchmark::State &state) {
+  std::vector<AST> forms = ParseCorpus();
+  size_t size = 0;
+  for (auto _ : state) {
+    std::ostringstream output;
+    for (const AST &form : forms) {
+      output << form << '\n';
+    }
+    size = output.str().size();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+  ReportNodes(&state, forms);
+}
+
+void BM_Serialize(benchmark::State &state, Serializer::Mode mode) {
+  std::vector<AST> forms = ParseCorpus();
+  size_t size = 0;
+  for (auto _ : state) {
+    Serializer serializer(mode);
+    for (const AST &form : forms) {
+      serializer.Write(form);
+    }
+    size = serializer.size();
+    benchmark::DoNotOptimize(serializer.buffer().data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+  ReportNodes(&state, forms);
+}
+
+BENCHMARK(BM_Copy);
+BENCHMARK(BM_Equal);
+BENCHMARK(BM_Print);
+BENCHMARK_CAPTURE(BM_Serialize, compact, Serializer::COMPACT);
+BENCHMARK_CAPTURE(BM_Serialize, pretty, Serializer::PRETTY);
+
+}  // namespace bench
+}  // namespace lisparser
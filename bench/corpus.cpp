@@ -0,0 +1,207 @@
+#include "bench/corpus.h"
+
+namespace lisparser {
+namespace bench {
+
+namespace {
+// SplitMix64, whose output is fully specified, unlike that of the
+// <random> distributions.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : _state(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in [0, bound), up to a negligible bias.
+  size_t Below(size_t bound) {
+    return static_cast<size_t>(Next() % bound);
+  }
+
+ private:
+  uint64_t _state;
+};
+
+constexpr char LETTERS[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-";
+constexpr size_t NUM_LETTERS = sizeof(LETTERS) - 1;
+
+void AppendName(Random *random, std::string *output) {
+  size_t length = 1 + random->Below(12);
+  // Names never start with a dash, which would make them numbers.
+  output->push_back(LETTERS[random->Below(NUM_LETTERS - 1)]);
+  for (size_t i = 1; i < length; ++i) {
+    output->push_back(LETTERS[random->Below(NUM_LETTERS)]);
+  }
+}
+
+void AppendNumber(Random *random, std::string *output) {
+  if (random->Below(4) == 0) output->push_back('-');
+  *output += std::to_string(random->Next() >> (4 + random->Below(56)));
+  if (random->Below(2) == 0) {
+    output->push_back('.');
+    *output += std::to_string(random->Below(1000000));
+  }
+}
+
+void AppendString(Random *random, std::string *output) {
+  output->push_back('"');
+  size_t length = random->Below(48);
+  for (size_t i = 0; i < length; ++i) {
+    size_t choice = random->Below(32);
+    if (choice == 0) {
+      *output += "\\\"";
+    } else if (choice == 1) {
+      *output += "\\\\";
+    } else if (choice < 6) {
+      output->push_back(' ');
+    } else {
+      output->push_back(LETTERS[random->Below(NUM_LETTERS)]);
+    }
+  }
+  output->push_back('"');
+}
+
+// Appends one atom of any kind.
+void AppendAtom(Random *random, std::string *output) {
+  switch (random->Below(4)) {
+    case 0:
+      output->push_back(':');
+      AppendName(random, output);
+      break;
+    case 1:
+      AppendNumber(random, output);
+      break;
+    case 2:
+      AppendString(random, output);
+      break;
+    default:
+      AppendName(random, output);
+      break;
+  }
+}
+
+void AppendTree(size_t depth, size_t width, Random *random,
+                std::string *output) {
+  output->push_back('(');
+  for (size_t i = 0; i < width; ++i) {
+    if (i > 0) output->push_back(' ');
+    AppendAtom(random, output);
+  }
+  if (depth > 1) {
+    output->push_back(' ');
+    AppendTree(depth - 1, width, random, output);
+  }
+  output->push_back(')');
+}
+}  // namespace
+
+std::string GenerateTokens(TokenMix mix, size_t size, uint64_t seed) {
+  Random random(seed);
+  std::string output;
+  output.reserve(size + 256);
+
+  while (output.size() < size) {
+    if (mix == COMMENTS) {
+      output += ";; ";
+      size_t words = 2 + random.Below(10);
+      for (size_t i = 0; i < words; ++i) {
+        AppendName(&random, &output);
+        output.push_back(' ');
+      }
+      output.push_back('\n');
+    }
+
+    output.push_back('(');
+    size_t length = mix == COMMENTS ? 2 : 8;
+    for (size_t i = 0; i < length; ++i) {
+      if (i > 0) output.push_back(' ');
+      // One token in eight is of another kind, for a realistic mix.
+      if (random.Below(8) == 0) {
+        AppendAtom(&random, &output);
+        continue;
+      }
+      switch (mix) {
+        case SYMBOLS:
+          if (random.Below(4) == 0) output.push_back(':');
+          AppendName(&random, &output);
+          break;
+        case NUMBERS:
+          AppendNumber(&random, &output);
+          break;
+        case STRINGS:
+          AppendString(&random, &output);
+          break;
+        case COMMENTS:
+          AppendName(&random, &output);
+          break;
+      }
+    }
+    output += ")\n";
+  }
+
+  return output;
+}
+
+std::string GenerateTrees(size_t depth, size_t width, size_t size,
+                          uint64_t seed) {
+  Random random(seed);
+  std::string output;
+  output.reserve(size + 256);
+  while (output.size() < size) {
+    AppendTree(depth, width, &random, &output);
+    output.push_back('\n');
+  }
+  return output;
+}
+
+std::string GenerateMacros(size_t num_macros) {
+  std::string output;
+  for (size_t i = 0; i < num_macros; ++i) {
+    std::string name = ":m" + std::to_string(i);
+    if (i == 0) {
+      output += "(defmacro :m0 (a b) (list ,a (quote ,b) ,a))\n";
+    } else {
+      output += "(defmacro " + name + " (a b) (:m" + std::to_string(i - 1) +
+                " (f ,a 1) (g ,b \"constant\")))\n";
+    }
+  }
+  return output;
+}
+
+std::string GenerateMacroCalls(size_t num_macros, size_t size,
+                               uint64_t seed) {
+  Random random(seed);
+  std::string output;
+  output.reserve(size + 256);
+  while (output.size() < size) {
+    output += "(define ";
+    AppendName(&random, &output);
+    output.push_back(' ');
+    AppendTree(3, 4, &random, &output);
+    output += " (:m" + std::to_string(random.Below(num_macros)) + " ";
+    AppendTree(2, 2, &random, &output);
+    output.push_back(' ');
+    AppendAtom(&random, &output);
+    output += ") ";
+    AppendTree(3, 4, &random, &output);
+    output += ")\n";
+  }
+  return output;
+}
+
+size_t CountNodes(const AST &ast) {
+  if (ast.type() != AST::LIST) return 1;
+  size_t count = 1;
+  for (const AST &child : ast.AsVector()) {
+    count += CountNodes(child);
+  }
+  return count;
+}
+
+}  // namespace bench
+}  // namespace lisparser
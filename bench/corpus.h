@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "ast.h"
+
+namespace lisparser {
+namespace bench {
+
+// The synthetic inputs of the benchmarks. They only depend on their
+// arguments (and the seed), so that numbers from different runs and
+// machines measure the same work.
+enum TokenMix {
+  // Mixed-case symbols and keywords of various lengths.
+  SYMBOLS = 0,
+  // Integers and doubles, with signs.
+  NUMBERS = 1,
+  // Strings, some of them with escapes.
+  STRINGS = 2,
+  // Line comments between short forms.
+  COMMENTS = 3,
+};
+
+// Flat top-level forms made mostly of the given kind of tokens, up to
+// about size bytes.
+std::string GenerateTokens(TokenMix mix, size_t size, uint64_t seed = 1);
+
+// Top-level forms that are lists of width atoms followed by a nested
+// list of the same shape, depth lists deep in total, up to about size
+// bytes. A large width and small depth make shallow and wide trees, a
+// width of 1 and large depth make deep and narrow ones.
+std::string GenerateTrees(size_t depth, size_t width, size_t size,
+                          uint64_t seed = 1);
+
+// The defmacro forms of num_macros macros :m0, :m1, ..., each of which
+// expands into a call to the previous one, so that expanding a call to
+// :mN takes N + 1 rounds.
+std::string GenerateMacros(size_t num_macros);
+
+// Top-level forms that call the macros of GenerateMacros() among
+// subtrees without any macro call, up to about size bytes.
+std::string GenerateMacroCalls(size_t num_macros, size_t size,
+                               uint64_t seed = 1);
+
+// The number of nodes in the tree, lists included.
+size_t CountNodes(const AST &ast);
+
+}  // namespace bench
+}  // namespace lisparser
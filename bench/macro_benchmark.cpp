@@ -0,0 +1,120 @@
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "parser.h"
+#include "tool/macro.h"
+
+namespace lisparser {
+namespace bench {
+
+namespace {
+constexpr size_t CORPUS_SIZE = 1 << 20;
+
+std::vector<AST> ParseForms(const std::string &code) {
+  std::vector<AST> forms;
+  Parser parser(code);
+  for (auto form = parser.Next(); form.ok(); form = parser.Next()) {
+    forms.push_back(std::move(form.value()));
+  }
+  return forms;
+}
+
+// Acquires the macros of GenerateMacros(), or returns false.
+bool AcquireAll(size_t num_macros, macro::Engine *engine) {
+  return engine->Acquire(ParseForms(GenerateMacros(num_macros))).ok();
+}
+
+void ReportRates(benchmark::State *state, const std::string &code,
+                 const std::vector<AST> &forms) {
+  size_t num_nodes = 0;
+  for (const AST &form : forms) {
+    num_nodes += CountNodes(form);
+  }
+  state->SetBytesProcessed(
+      static_cast<int64_t>(state->iterations() * code.size()));
+  state->counters["nodes"] = benchmark::Counter(
+      static_cast<double>(num_nodes),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+}  // namespace
+
+void BM_Acquire(benchmark::State &state) {
+  size_t num_macros = static_cast<size_t>(state.range(0));
+  std::vector<AST> definitions = ParseForms(GenerateMacros(num_macros));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<AST> copies;
+    for (const AST &definition : definitions) {
+      copies.push_back(definition.Copy());
+    }
+    macro::Engine engine;
+    state.ResumeTiming();
+
+    for (AST &copy : copies) {
+      engine.Acquire(std::move(copy));
+    }
+  }
+
+  state.counters["macros"] = benchmark::Counter(
+      static_cast<double>(num_macros),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// The argument is the number of nested macros, i.e. the largest number
+// of rounds a call takes to expand.
+void BM_Evaluate(benchmark::State &state) {
+  size_t num_macros = static_cast<size_t>(state.range(0));
+  macro::Engine engine;
+  if (!AcquireAll(num_macros, &engine)) {
+    state.SkipWithError("the macros do not compile");
+    return;
+  }
+  std::string code = GenerateMacroCalls(num_macros, CORPUS_SIZE);
+  std::vector<AST> forms = ParseForms(code);
+
+  for (auto _ : state) {
+    for (const AST &form : forms) {
+      auto result = engine.Evaluate(form);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  ReportRates(&state, code, forms);
+}
+
+// Same as above with owned forms, which are evaluated in place, on the
+// number of threads given by the second argument.
+void BM_EvaluateAll(benchmark::State &state) {
+  size_t num_macros = static_cast<size_t>(state.range(0));
+  size_t num_threads = static_cast<size_t>(state.range(1));
+  macro::Engine engine;
+  if (!AcquireAll(num_macros, &engine)) {
+    state.SkipWithError("the macros do not compile");
+    return;
+  }
+  std::string code = GenerateMacroCalls(num_macros, CORPUS_SIZE);
+  std::vector<AST> forms = ParseForms(code);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<AST> copies;
+    copies.reserve(forms.size());
+    for (const AST &form : forms) {
+      copies.push_back(form.Copy());
+    }
+    state.ResumeTiming();
+
+    auto results = engine.EvaluateAll(std::move(copies), num_threads);
+    benchmark::DoNotOptimize(results.data());
+  }
+  ReportRates(&state, code, forms);
+}
+
+BENCHMARK(BM_Acquire)->Arg(16)->Arg(256);
+BENCHMARK(BM_Evaluate)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK(BM_EvaluateAll)->Args({4, 1})->Args({4, 2})->Args({4, 4})
+    ->UseRealTime();
+
+}  // namespace bench
+}  // namespace lisparser
@@ -0,0 +1,55 @@
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "buffer_tokenizer.h"
+#include "parser.h"
+
+namespace lisparser {
+namespace bench {
+
+namespace {
+constexpr size_t CORPUS_SIZE = 1 << 20;
+
+// Parses all the forms of the code, or returns false on an error.
+bool ParseAll(const std::string &code, std::vector<AST> *forms) {
+  Parser parser(new BufferTokenizer(code.data(), code.size()));
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) return form.error_code() == Parser::EMPTY;
+    forms->push_back(std::move(form.value()));
+  } while (true);
+}
+}  // namespace
+
+void BM_Parser(benchmark::State &state, size_t depth, size_t width) {
+  std::string code = GenerateTrees(depth, width, CORPUS_SIZE);
+  std::vector<AST> forms;
+  if (!ParseAll(code, &forms)) {
+    state.SkipWithError("the corpus does not parse");
+    return;
+  }
+  size_t num_nodes = 0;
+  for (const AST &form : forms) {
+    num_nodes += CountNodes(form);
+  }
+
+  for (auto _ : state) {
+    forms.clear();
+    ParseAll(code, &forms);
+    benchmark::DoNotOptimize(forms.data());
+  }
+
+  state.SetBytesProcessed(
+      static_cast<int64_t>(state.iterations() * code.size()));
+  state.counters["nodes"] = benchmark::Counter(
+      static_cast<double>(num_nodes),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(BM_Parser, shallow_wide, 2, 128);
+BENCHMARK_CAPTURE(BM_Parser, medium, 8, 8);
+BENCHMARK_CAPTURE(BM_Parser, deep_narrow, 2000, 1);
+
+}  // namespace bench
+}  // namespace lisparser
@@ -0,0 +1,75 @@
+#include <string>
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "buffer_tokenizer.h"
+#include "dfa_tokenizer.h"
+#include "tokenizer.h"
+
+namespace lisparser {
+namespace bench {
+
+namespace {
+constexpr size_t CORPUS_SIZE = 1 << 20;
+
+// Reports the throughput of a benchmark that went through the whole
+// code once per iteration.
+void ReportRates(benchmark::State *state, const std::string &code,
+                 size_t num_tokens) {
+  state->SetBytesProcessed(
+      static_cast<int64_t>(state->iterations() * code.size()));
+  state->counters["tokens"] = benchmark::Counter(
+      static_cast<double>(num_tokens),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+}  // namespace
+
+void BM_Tokenizer(benchmark::State &state, TokenMix mix) {
+  std::string code = GenerateTokens(mix, CORPUS_SIZE);
+  size_t num_tokens = 0;
+  for (auto _ : state) {
+    Tokenizer tokenizer(code);
+    num_tokens = 0;
+    while (tokenizer.Next().type != Token::TERMINATOR) ++num_tokens;
+  }
+  ReportRates(&state, code, num_tokens);
+}
+
+void BM_BufferTokenizer(benchmark::State &state, TokenMix mix) {
+  std::string code = GenerateTokens(mix, CORPUS_SIZE);
+  size_t num_tokens = 0;
+  for (auto _ : state) {
+    BufferTokenizer tokenizer(code.data(), code.size());
+    num_tokens = 0;
+    while (tokenizer.Next().type != Token::TERMINATOR) ++num_tokens;
+  }
+  ReportRates(&state, code, num_tokens);
+}
+
+void BM_DfaTokenizer(benchmark::State &state, TokenMix mix) {
+  std::string code = GenerateTokens(mix, CORPUS_SIZE);
+  size_t num_tokens = 0;
+  for (auto _ : state) {
+    DfaTokenizer tokenizer(code.data(), code.size());
+    num_tokens = 0;
+    while (tokenizer.Next().type != Token::TERMINATOR) ++num_tokens;
+  }
+  ReportRates(&state, code, num_tokens);
+}
+
+BENCHMARK_CAPTURE(BM_Tokenizer, symbols, SYMBOLS);
+BENCHMARK_CAPTURE(BM_Tokenizer, numbers, NUMBERS);
+BENCHMARK_CAPTURE(BM_Tokenizer, strings, STRINGS);
+BENCHMARK_CAPTURE(BM_Tokenizer, comments, COMMENTS);
+
+BENCHMARK_CAPTURE(BM_BufferTokenizer, symbols, SYMBOLS);
+BENCHMARK_CAPTURE(BM_BufferTokenizer, numbers, NUMBERS);
+BENCHMARK_CAPTURE(BM_BufferTokenizer, strings, STRINGS);
+BENCHMARK_CAPTURE(BM_BufferTokenizer, comments, COMMENTS);
+
+BENCHMARK_CAPTURE(BM_DfaTokenizer, symbols, SYMBOLS);
+BENCHMARK_CAPTURE(BM_DfaTokenizer, numbers, NUMBERS);
+BENCHMARK_CAPTURE(BM_DfaTokenizer, strings, STRINGS);
+BENCHMARK_CAPTURE(BM_DfaTokenizer, comments, COMMENTS);
+
+}  // namespace bench
+}  // namespace lisparser
@@ -0,0 +1,655 @@
+#include "binary.h"
+
+#include <cassert>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace lisparser {
+
+namespace {
+constexpr char MAGIC[4] = {'L', 'S', 'P', 'B'};
+
+enum Tag : uint8_t {
+  TAG_KEYWORD = 0,
+  TAG_SYMBOL = 1,
+  TAG_STRING = 2,
+  TAG_FLOAT = 3,
+  TAG_INTEGER = 4,
+  TAG_LIST = 5,
+  TAG_EVAL_FORM = 6,
+};
+
+// Encodes the forms in two passes: the first one builds the string
+// table and measures the lists, so that the second one can write the
+// size of every list before its children.
+class Writer {
+ public:
+  Writer() : _table(), _strings(), _string_ends(), _list_sizes(),
+             _next_list(0), _nodes_size(0), _nodes() {}
+
+  void MeasureForm(const AST &form) {
+    _nodes_size += Measure(form);
+  }
+
+  void WriteForm(const AST &form) {
+    if (_nodes.empty()) _nodes.reserve(_nodes_size);
+
+    switch (form.type()) {
+      case AST::KEYWORD:
+        WriteString(TAG_KEYWORD, form.AsString());
+        return;
+      case AST::SYMBOL:
+        WriteString(TAG_SYMBOL, form.AsString());
+        return;
+      case AST::EVAL_FORM:
+        WriteString(TAG_EVAL_FORM, form.AsString());
+        return;
+      case AST::STRING:
+        WriteString(TAG_STRING, form.AsString());
+        return;
+      case AST::INTEGER:
+        _nodes.push_back(TAG_INTEGER);
+        WriteVarint(&_nodes, ZigZag(form.AsInt64()));
+        return;
+      case AST::FLOAT: {
+        uint64_t bits;
+        double value = form.AsDouble();
+        std::memcpy(&bits, &value, sizeof(bits));
+        _nodes.push_back(TAG_FLOAT);
+        WriteFixed64(&_nodes, bits);
+        return;
+      }
+      case AST::LIST:
+        _nodes.push_back(TAG_LIST);
+        WriteVarint(&_nodes, form.AsVector().size());
+        WriteVarint(&_nodes, _list_sizes[_next_list++]);
+        for (const AST &child : form.AsVector()) {
+          WriteForm(child);
+        }
+        return;
+    }
+  }
+
+  std::string Finish(size_t num_forms) {
+    std::string output(MAGIC, sizeof(MAGIC));
+    output.push_back(static_cast<char>(BINARY_VERSION));
+    WriteVarint(&output, _string_ends.size());
+    WriteFixed64(&output, 0);
+    for (uint64_t end : _string_ends) {
+      WriteFixed64(&output, end);
+    }
+    output += _strings;
+    WriteVarint(&output, num_forms);
+    output += _nodes;
+    return output;
+  }
+
+  static void WriteVarint(std::string *output, uint64_t value) {
+    while (value >= 0x80) {
+      output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    output->push_back(static_cast<char>(value));
+  }
+
+ private:
+  static uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+        static_cast<uint64_t>(value >> 63);
+  }
+
+  static size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    for (; value >= 0x80; value >>= 7) ++size;
+    return size;
+  }
+
+  static void WriteFixed64(std::string *output, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+      output->push_back(static_cast<char>(value >> (8 * i)));
+    }
+  }
+
+  // Returns the size of the encoding of the form.
+  size_t Measure(const AST &form) {
+    switch (form.type()) {
+      case AST::KEYWORD:
+      case AST::SYMBOL:
+      case AST::EVAL_FORM:
+      case AST::STRING:
+        return 1 + VarintSize(AddString(form.AsString()));
+      case AST::INTEGER:
+        return 1 + VarintSize(ZigZag(form.AsInt64()));
+      case AST::FLOAT:
+        return 9;
+      case AST::LIST: {
+        // The lists are measured in the order they are written.
+        size_t list = _list_sizes.size();
+        _list_sizes.push_back(0);
+        size_t size = 0;
+        for (const AST &child : form.AsVector()) {
+          size += Measure(child);
+        }
+        _list_sizes[list] = size;
+        return 1 + VarintSize(form.AsVector().size()) + VarintSize(size) +
+            size;
+      }
+    }
+    return 0;
+  }
+
+  // Returns the index of the string in the table, adding it if needed.
+  uint64_t AddString(std::string_view content) {
+    auto iter = _table.find(content);
+    if (iter != _table.end()) return iter->second;
+    _strings.append(content.data(), content.size());
+    _string_ends.push_back(_strings.size());
+    return _table.emplace(content, _table.size()).first->second;
+  }
+
+  void WriteString(Tag tag, std::string_view content) {
+    _nodes.push_back(tag);
+    WriteVarint(&_nodes, _table.find(content)->second);
+  }
+
+  // The index of every string in the table. The keys point into the
+  // ASTs being encoded.
+  std::unordered_map<std::string_view, uint64_t> _table;
+  std::string _strings;
+  // Where every string of the table ends in _strings.
+  std::vector<uint64_t> _string_ends;
+  // The size of the children of every list, in the order of the lists.
+  std::vector<uint64_t> _list_sizes;
+  size_t _next_list;
+  size_t _nodes_size;
+  std::string _nodes;
+};
+
+uint64_t DecodeFixed64(const char *bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i]))
+        << (8 * i);
+  }
+  return value;
+}
+
+int64_t DecodeZigZag(uint64_t zigzag) {
+  return static_cast<int64_t>(zigzag >> 1) ^
+      -static_cast<int64_t>(zigzag & 1);
+}
+
+double DecodeDouble(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+class Reader {
+ public:
+  Reader(const char *data, size_t size)
+      : _data(data), _size(size), _position(0) {}
+
+  bool ReadByte(uint8_t *byte) {
+    if (_position >= _size) return false;
+    *byte = static_cast<uint8_t>(_data[_position++]);
+    return true;
+  }
+
+  bool ReadVarint(uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!ReadByte(&byte)) return false;
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+  }
+
+  bool ReadBytes(uint64_t size, std::string_view *bytes) {
+    if (size > _size - _position) return false;
+    *bytes = std::string_view(_data + _position, size);
+    _position += size;
+    return true;
+  }
+
+  bool ReadFixed64(uint64_t *value) {
+    std::string_view bytes;
+    if (!ReadBytes(8, &bytes)) return false;
+    *value = DecodeFixed64(bytes.data());
+    return true;
+  }
+
+  inline const char *current() const {
+    return _data + _position;
+  }
+
+  inline size_t remaining() const {
+    return _size - _position;
+  }
+
+ private:
+  const char *_data;
+  size_t _size;
+  size_t _position;
+};
+
+// The string table of an encoding, whose names are interned on first
+// use.
+struct TableEntry {
+  std::string_view content;
+  SymbolId symbol;
+};
+
+constexpr char CORRUPTED_MESSAGE[] = "Corrupted binary AST encoding.";
+
+util::Result<AST> CorruptedError() {
+  return util::Result<AST>(CORRUPTED, CORRUPTED_MESSAGE);
+}
+
+// Where the parts of an encoding start, once its header and string
+// table have been checked. The reader is left on the first node.
+struct Sections {
+  const char *offsets;
+  const char *strings;
+  uint64_t num_strings;
+  uint64_t num_forms;
+};
+
+util::Result<Sections> ReadSections(Reader *reader) {
+  using SectionsResult = util::Result<Sections>;
+
+  std::string_view magic;
+  uint8_t version;
+  if (!reader->ReadBytes(sizeof(MAGIC), &magic) ||
+      magic != std::string_view(MAGIC, sizeof(MAGIC)) ||
+      !reader->ReadByte(&version) || version != BINARY_VERSION) {
+    return SectionsResult(BAD_HEADER, "Not a binary AST encoding.");
+  }
+
+  Sections sections;
+  // There is one more offset than strings.
+  if (!reader->ReadVarint(&sections.num_strings) ||
+      sections.num_strings >= reader->remaining() / 8) {
+    return SectionsResult(CORRUPTED, CORRUPTED_MESSAGE);
+  }
+  sections.offsets = reader->current();
+  uint64_t end = 0;
+  for (uint64_t i = 0; i <= sections.num_strings; ++i) {
+    uint64_t offset;
+    if (!reader->ReadFixed64(&offset) ||
+        (i == 0 ? offset != 0 : offset < end)) {
+      return SectionsResult(CORRUPTED, CORRUPTED_MESSAGE);
+    }
+    end = offset;
+  }
+  sections.strings = reader->current();
+  std::string_view strings;
+  if (!reader->ReadBytes(end, &strings)) {
+    return SectionsResult(CORRUPTED, CORRUPTED_MESSAGE);
+  }
+
+  // Every node takes at least two bytes.
+  if (!reader->ReadVarint(&sections.num_forms) ||
+      sections.num_forms > reader->remaining() / 2) {
+    return SectionsResult(CORRUPTED, CORRUPTED_MESSAGE);
+  }
+  return sections;
+}
+
+// Reads what follows the tag of a list, and checks that the children
+// fit into the rest of the encoding.
+bool ReadListHeader(Reader *reader, uint64_t *num_children,
+                    uint64_t *size) {
+  if (!reader->ReadVarint(num_children) || !reader->ReadVarint(size) ||
+      *size > reader->remaining()) {
+    return false;
+  }
+  // Every node takes at least two bytes, and the children of an empty
+  // list take none.
+  return *num_children <= *size / 2 && (*num_children > 0 || *size == 0);
+}
+
+// Reads what follows the tag of a node other than a list, and returns
+// whether it is valid.
+bool SkipAtom(uint8_t tag, Reader *reader, uint64_t num_strings) {
+  uint64_t value;
+  switch (tag) {
+    case TAG_KEYWORD:
+    case TAG_SYMBOL:
+    case TAG_EVAL_FORM:
+    case TAG_STRING:
+      return reader->ReadVarint(&value) && value < num_strings;
+    case TAG_INTEGER:
+      return reader->ReadVarint(&value);
+    case TAG_FLOAT:
+      return reader->ReadFixed64(&value);
+    default:
+      return false;
+  }
+}
+
+// Decodes a node other than a list.
+util::Result<AST> ReadAtom(uint8_t tag, Reader *reader,
+                          std::vector<TableEntry> *table,
+                          std::pmr::memory_resource *resource) {
+  switch (tag) {
+    case TAG_KEYWORD:
+    case TAG_SYMBOL:
+    case TAG_EVAL_FORM:
+    case TAG_STRING: {
+      uint64_t index;
+      if (!reader->ReadVarint(&index) || index >= table->size()) {
+        return CorruptedError();
+      }
+      TableEntry &entry = (*table)[index];
+      if (tag == TAG_STRING) return AST::String(entry.content, resource);
+
+      if (entry.symbol == SymbolId()) {
+        entry.symbol = SymbolId::Intern(entry.content);
+      }
+      if (tag == TAG_KEYWORD) return AST::Keyword(entry.symbol);
+      if (tag == TAG_SYMBOL) return AST::Symbol(entry.symbol);
+      return AST::EvalForm(entry.symbol);
+    }
+
+    case TAG_INTEGER: {
+      uint64_t zigzag;
+      if (!reader->ReadVarint(&zigzag)) return CorruptedError();
+      return AST::Integer(DecodeZigZag(zigzag));
+    }
+
+    case TAG_FLOAT: {
+      uint64_t bits;
+      if (!reader->ReadFixed64(&bits)) return CorruptedError();
+      return AST::Double(DecodeDouble(bits));
+    }
+
+    default:
+      return CorruptedError();
+  }
+}
+}  // namespace
+
+std::string EncodeBinary(const std::vector<AST> &forms) {
+  Writer writer;
+  for (const AST &form : forms) {
+    writer.MeasureForm(form);
+  }
+  for (const AST &form : forms) {
+    writer.WriteForm(form);
+  }
+  return writer.Finish(forms.size());
+}
+
+util::Result<std::vector<AST>> DecodeBinary(
+    const char *data, size_t size, size_t max_depth,
+    std::pmr::memory_resource *resource) {
+  using FormsResult = util::Result<std::vector<AST>>;
+
+  Reader reader(data, size);
+  auto sections = ReadSections(&reader);
+  if (!sections.ok()) return FormsResult::ErrorFrom(std::move(sections));
+  uint64_t num_forms = sections.value().num_forms;
+
+  std::vector<TableEntry> table(sections.value().num_strings);
+  for (size_t i = 0; i < table.size(); ++i) {
+    const char *offsets = sections.value().offsets + 8 * i;
+    uint64_t begin = DecodeFixed64(offsets);
+    table[i].content = std::string_view(sections.value().strings + begin,
+                                        DecodeFixed64(offsets + 8) - begin);
+  }
+
+  std::vector<AST> forms;
+  forms.reserve(num_forms);
+  // The lists being decoded, innermost last.
+  struct OpenList {
+    AST list;
+    // The number of children it still misses.
+    uint64_t remaining;
+    // Where its children end.
+    const char *end;
+  };
+  std::vector<OpenList> stack;
+
+  while (forms.size() < num_forms) {
+    uint8_t tag;
+    if (!reader.ReadByte(&tag)) {
+      return FormsResult::ErrorFrom(CorruptedError());
+    }
+
+    AST node = AST::Integer(0);
+    if (tag == TAG_LIST) {
+      uint64_t num_children, children_size;
+      if (!ReadListHeader(&reader, &num_children, &children_size)) {
+        return FormsResult::ErrorFrom(CorruptedError());
+      }
+      node = AST::Vector(resource);
+      if (num_children > 0) {
+        const char *end = reader.current() + children_size;
+        if (!stack.empty() && end > stack.back().end) {
+          return FormsResult::ErrorFrom(CorruptedError());
+        }
+        if (stack.size() >= max_depth) {
+          return FormsResult(BINARY_TOO_DEEP,
+                             util::StrCat("Nesting deeper than ", max_depth,
+                                          " levels."));
+        }
+        stack.push_back({std::move(node), num_children, end});
+        continue;
+      }
+    } else {
+      util::Result<AST> atom = ReadAtom(tag, &reader, &table, resource);
+      if (!atom.ok()) return FormsResult::ErrorFrom(std::move(atom));
+      node = std::move(atom).value();
+    }
+
+    // Add the node to its list, and the lists it completes to theirs.
+    do {
+      if (stack.empty()) {
+        forms.push_back(std::move(node));
+        break;
+      }
+      stack.back().list.Push(std::move(node));
+      if (--stack.back().remaining > 0) break;
+      if (reader.current() != stack.back().end) {
+        return FormsResult::ErrorFrom(CorruptedError());
+      }
+      node = std::move(stack.back().list);
+      stack.pop_back();
+    } while (true);
+  }
+
+  if (reader.remaining() > 0) {
+    return FormsResult::ErrorFrom(CorruptedError());
+  }
+  return forms;
+}
+
+AST::Type BinaryNode::type() const {
+  switch (static_cast<uint8_t>(*_node)) {
+    case TAG_KEYWORD:
+      return AST::KEYWORD;
+    case TAG_SYMBOL:
+      return AST::SYMBOL;
+    case TAG_STRING:
+      return AST::STRING;
+    case TAG_FLOAT:
+      return AST::FLOAT;
+    case TAG_INTEGER:
+      return AST::INTEGER;
+    case TAG_EVAL_FORM:
+      return AST::EVAL_FORM;
+    default:
+      return AST::LIST;
+  }
+}
+
+std::string_view BinaryNode::AsString() const {
+  assert(type() != AST::LIST && type() != AST::INTEGER &&
+         type() != AST::FLOAT);
+  Reader reader(_node + 1, _view->_end - _node - 1);
+  uint64_t index;
+  reader.ReadVarint(&index);
+  return _view->String(index);
+}
+
+int64_t BinaryNode::AsInt64() const {
+  assert(type() == AST::INTEGER);
+  Reader reader(_node + 1, _view->_end - _node - 1);
+  uint64_t zigzag;
+  reader.ReadVarint(&zigzag);
+  return DecodeZigZag(zigzag);
+}
+
+double BinaryNode::AsDouble() const {
+  assert(type() == AST::FLOAT);
+  return DecodeDouble(DecodeFixed64(_node + 1));
+}
+
+size_t BinaryNode::size() const {
+  if (static_cast<uint8_t>(*_node) != TAG_LIST) return 0;
+  Reader reader(_node + 1, _view->_end - _node - 1);
+  uint64_t num_children;
+  reader.ReadVarint(&num_children);
+  return num_children;
+}
+
+BinaryCursor BinaryNode::children() const {
+  if (static_cast<uint8_t>(*_node) != TAG_LIST) {
+    return BinaryCursor(_view, nullptr, 0);
+  }
+  Reader reader(_node + 1, _view->_end - _node - 1);
+  uint64_t num_children, children_size;
+  reader.ReadVarint(&num_children);
+  reader.ReadVarint(&children_size);
+  return BinaryCursor(_view, reader.current(), num_children);
+}
+
+AST BinaryNode::Materialize(std::pmr::memory_resource *resource) const {
+  switch (type()) {
+    case AST::KEYWORD:
+      return AST::Keyword(SymbolId::Intern(AsString()));
+    case AST::SYMBOL:
+      return AST::Symbol(SymbolId::Intern(AsString()));
+    case AST::EVAL_FORM:
+      return AST::EvalForm(SymbolId::Intern(AsString()));
+    case AST::STRING:
+      return AST::String(AsString(), resource);
+    case AST::INTEGER:
+      return AST::Integer(AsInt64());
+    case AST::FLOAT:
+      return AST::Double(AsDouble());
+    case AST::LIST:
+      break;
+  }
+
+  // The depth was checked when opening the view.
+  AST list = AST::Vector(resource);
+  BinaryCursor cursor = children();
+  BinaryNode child;
+  while (cursor.Next(&child)) {
+    list.Push(child.Materialize(resource));
+  }
+  return list;
+}
+
+const char *BinaryNode::end() const {
+  Reader reader(_node + 1, _view->_end - _node - 1);
+  uint64_t value;
+  switch (static_cast<uint8_t>(*_node)) {
+    case TAG_FLOAT:
+      return _node + 9;
+    case TAG_LIST: {
+      uint64_t children_size;
+      reader.ReadVarint(&value);
+      reader.ReadVarint(&children_size);
+      return reader.current() + children_size;
+    }
+    default:
+      reader.ReadVarint(&value);
+      return reader.current();
+  }
+}
+
+bool BinaryCursor::Next(BinaryNode *node) {
+  if (_remaining == 0) return false;
+  *node = BinaryNode(_view, _next);
+  _next = node->end();
+  --_remaining;
+  return true;
+}
+
+util::Result<BinaryView> BinaryView::Open(const char *data, size_t size,
+                                          size_t max_depth) {
+  using ViewResult = util::Result<BinaryView>;
+
+  Reader reader(data, size);
+  auto sections = ReadSections(&reader);
+  if (!sections.ok()) return ViewResult::ErrorFrom(std::move(sections));
+  const char *nodes = reader.current();
+
+  // Check every node, so that the nodes of the view can be read without
+  // checking anything. The lists being checked, innermost last, with the
+  // number of children they still miss and where their children end.
+  std::vector<std::pair<uint64_t, const char*>> stack;
+  uint64_t num_forms = 0;
+  while (num_forms < sections.value().num_forms) {
+    uint8_t tag;
+    if (!reader.ReadByte(&tag)) return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+
+    if (tag == TAG_LIST) {
+      uint64_t num_children, children_size;
+      if (!ReadListHeader(&reader, &num_children, &children_size)) {
+        return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+      }
+      if (num_children > 0) {
+        const char *end = reader.current() + children_size;
+        if (!stack.empty() && end > stack.back().second) {
+          return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+        }
+        if (stack.size() >= max_depth) {
+          return ViewResult(BINARY_TOO_DEEP,
+                            util::StrCat("Nesting deeper than ", max_depth,
+                                         " levels."));
+        }
+        stack.emplace_back(num_children, end);
+        continue;
+      }
+    } else if (!SkipAtom(tag, &reader, sections.value().num_strings)) {
+      return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+    }
+
+    // Count the node, and the lists it completes.
+    do {
+      if (stack.empty()) {
+        ++num_forms;
+        break;
+      }
+      if (--stack.back().first > 0) break;
+      if (reader.current() != stack.back().second) {
+        return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+      }
+      stack.pop_back();
+    } while (true);
+  }
+
+  if (reader.remaining() > 0) return ViewResult(CORRUPTED, CORRUPTED_MESSAGE);
+  return BinaryView(sections.value().offsets, sections.value().strings,
+                    nodes, data + size, num_forms);
+}
+
+BinaryCursor BinaryView::forms() const {
+  return BinaryCursor(this, _nodes, _num_forms);
+}
+
+std::string_view BinaryView::String(uint64_t index) const {
+  uint64_t begin = DecodeFixed64(_offsets + 8 * index);
+  return std::string_view(_strings + begin,
+                          DecodeFixed64(_offsets + 8 * (index + 1)) - begin);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+// A compact binary encoding of a sequence of ASTs, which is much faster
+// to load than the code they were parsed from. It reads as
+//
+//   "LSPB" <version byte>
+//   <number of strings n> <offset>{n + 1} <bytes>   the string table
+//   <number of forms> <node>...
+//
+// where the offsets are 8 little-endian bytes each, string i being the
+// bytes between offsets i and i + 1, and the other numbers are unsigned
+// LEB128 varints. Each node starts with a tag byte followed by
+//
+//   SYMBOL, KEYWORD, EVAL_FORM, STRING: the index of its string
+//   INTEGER: its value as a zigzag varint
+//   FLOAT: its value as 8 little-endian bytes (IEEE 754)
+//   LIST: the number of children and their size in bytes, then them
+//
+// Every distinct string and name is stored once in the table, so that
+// decoding interns every name once instead of once per occurrence.
+// Decoding is a single pass over the encoding with no tokenizing. The
+// encoding can also be read in place through a BinaryView, e.g. from a
+// memory-mapped file, since strings are found through their offsets and
+// lists are skipped through their sizes.
+enum BinaryError {
+  // Not an encoding, or one of a version that is not supported.
+  BAD_HEADER = 1,
+  // Truncated, or with invalid tags or string indices.
+  CORRUPTED = 2,
+  // Nested deeper than the limit given to DecodeBinary().
+  BINARY_TOO_DEEP = 3,
+};
+
+constexpr uint8_t BINARY_VERSION = 2;
+
+std::string EncodeBinary(const std::vector<AST> &forms);
+
+// The ASTs are allocated from the resource.
+util::Result<std::vector<AST>> DecodeBinary(
+    const char *data, size_t size, size_t max_depth,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+class BinaryCursor;
+class BinaryView;
+
+// A node of a BinaryView, read from the encoding as it is accessed. It
+// refers to the view, which has to outlive it.
+class BinaryNode {
+ public:
+  BinaryNode() : _view(nullptr), _node(nullptr) {}
+
+  AST::Type type() const;
+
+  // The name of a symbol, keyword or eval form, or the content of a
+  // string. It points into the encoding.
+  std::string_view AsString() const;
+
+  int64_t AsInt64() const;
+
+  double AsDouble() const;
+
+  // The number of children of a list, 0 for an atom.
+  size_t size() const;
+
+  // Iterates through the children of a list, and through nothing for
+  // an atom.
+  BinaryCursor children() const;
+
+  // Decodes the whole node into an AST, allocated from the resource.
+  AST Materialize(std::pmr::memory_resource *resource =
+                      std::pmr::get_default_resource()) const;
+
+ private:
+  friend class BinaryCursor;
+
+  BinaryNode(const BinaryView *view, const char *node)
+      : _view(view), _node(node) {}
+
+  // Where the node ends, i.e. where the next one starts.
+  const char *end() const;
+
+  const BinaryView *_view;
+  // Points to the tag of the node.
+  const char *_node;
+};
+
+// Goes through a sequence of nodes, skipping over lists in constant
+// time.
+class BinaryCursor {
+ public:
+  // Sets the node to the next one, or returns false after the last one.
+  bool Next(BinaryNode *node);
+
+ private:
+  friend class BinaryNode;
+  friend class BinaryView;
+
+  BinaryCursor(const BinaryView *view, const char *next, uint64_t remaining)
+      : _view(view), _next(next), _remaining(remaining) {}
+
+  const BinaryView *_view;
+  const char *_next;
+  uint64_t _remaining;
+};
+
+// BinaryView reads an encoding in place: nothing is copied, allocated
+// or interned as its nodes are accessed, unless they are materialized.
+// Opening it checks the whole encoding in one pass, so that accessing
+// its nodes cannot fail. The encoding has to outlive the view, and the
+// view must not be moved while nodes or cursors refer to it.
+class BinaryView {
+ public:
+  // Fails with a BinaryError.
+  static util::Result<BinaryView> Open(const char *data, size_t size,
+                                       size_t max_depth);
+
+  BinaryView(BinaryView &&other) = default;
+
+  inline size_t num_forms() const {
+    return _num_forms;
+  }
+
+  // Iterates through the top-level forms.
+  BinaryCursor forms() const;
+
+ private:
+  friend class BinaryNode;
+
+  BinaryView(const char *offsets, const char *strings, const char *nodes,
+             const char *end, uint64_t num_forms)
+      : _offsets(offsets), _strings(strings), _nodes(nodes), _end(end),
+        _num_forms(num_forms) {}
+
+  BinaryView(const BinaryView&) = delete;
+  const BinaryView &operator=(const BinaryView&) = delete;
+
+  // The string of the table at the index.
+  std::string_view String(uint64_t index) const;
+
+  const char *_offsets;
+  const char *_strings;
+  const char *_nodes;
+  const char *_end;
+  uint64_t _num_forms;
+};
+
+}  // namespace lisparser
@@ -0,0 +1,233 @@
+#include "binary.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "util/arena.h"
+
+namespace lisparser {
+
+namespace {
+constexpr size_t MAX_DEPTH = 10000;
+
+std::vector<AST> MakeForms() {
+  std::vector<AST> forms;
+  forms.push_back(AST::Vector(
+      AST::Symbol("defun"), AST::Keyword(":key"), AST::EvalForm("x"),
+      AST::String("a string longer than the inline capacity"),
+      AST::String(""), AST::Vector(),
+      AST::Vector(AST::Integer(0), AST::Integer(-1), AST::Integer(300),
+                  AST::Integer(std::numeric_limits<int64_t>::min()),
+                  AST::Integer(std::numeric_limits<int64_t>::max()))));
+  forms.push_back(AST::Double(-1.5));
+  forms.push_back(AST::Double(1e300));
+  forms.push_back(AST::Symbol("defun"));
+  return forms;
+}
+}  // namespace
+
+TEST(Binary, RoundTripTest) {
+  // Outlives the forms decoded into it.
+  util::Arena arena;
+  std::vector<AST> forms = MakeForms();
+  std::string encoding = EncodeBinary(forms);
+
+  auto decoded = DecodeBinary(encoding.data(), encoding.size(), MAX_DEPTH);
+  ASSERT_TRUE(decoded.ok());
+  EXPECT_EQ(forms, decoded.value());
+  EXPECT_EQ(AST::Symbol("defun").AsSymbol(),
+            decoded.value()[3].AsSymbol());
+
+  decoded = DecodeBinary(encoding.data(), encoding.size(), MAX_DEPTH,
+                         &arena);
+  ASSERT_TRUE(decoded.ok());
+  EXPECT_EQ(forms, decoded.value());
+}
+
+TEST(Binary, EmptyTest) {
+  std::string encoding = EncodeBinary({});
+  auto decoded = DecodeBinary(encoding.data(), encoding.size(), MAX_DEPTH);
+  ASSERT_TRUE(decoded.ok());
+  EXPECT_TRUE(decoded.value().empty());
+}
+
+TEST(Binary, StringTableTest) {
+  std::vector<AST> forms;
+  for (int i = 0; i < 100; ++i) {
+    forms.push_back(AST::Symbol("a-rather-long-symbol-name"));
+  }
+  std::string encoding = EncodeBinary(forms);
+  // The name is stored once, and each node takes two bytes.
+  EXPECT_GT(250u, encoding.size());
+}
+
+TEST(Binary, DeepNestingTest) {
+  AST form = AST::Vector(AST::Integer(1));
+  for (int i = 0; i < 100; ++i) {
+    AST outer = AST::Vector();
+    outer.Push(std::move(form));
+    form = std::move(outer);
+  }
+  std::vector<AST> forms;
+  forms.push_back(std::move(form));
+  std::string encoding = EncodeBinary(forms);
+
+  auto decoded = DecodeBinary(encoding.data(), encoding.size(), 101);
+  ASSERT_TRUE(decoded.ok());
+  EXPECT_EQ(forms, decoded.value());
+
+  EXPECT_EQ(BINARY_TOO_DEEP,
+            DecodeBinary(encoding.data(), encoding.size(), 100)
+            .error_code());
+  EXPECT_TRUE(BinaryView::Open(encoding.data(), encoding.size(), 101).ok());
+  EXPECT_EQ(BINARY_TOO_DEEP,
+            BinaryView::Open(encoding.data(), encoding.size(), 100)
+            .error_code());
+}
+
+TEST(Binary, BadHeaderTest) {
+  std::string encoding = EncodeBinary(MakeForms());
+  EXPECT_EQ(BAD_HEADER, DecodeBinary("(a b)", 5, MAX_DEPTH).error_code());
+  EXPECT_EQ(BAD_HEADER,
+            BinaryView::Open("(a b)", 5, MAX_DEPTH).error_code());
+
+  encoding[4] = static_cast<char>(BINARY_VERSION + 1);
+  EXPECT_EQ(BAD_HEADER,
+            DecodeBinary(encoding.data(), encoding.size(), MAX_DEPTH)
+            .error_code());
+}
+
+TEST(Binary, CorruptedTest) {
+  std::string encoding = EncodeBinary(MakeForms());
+
+  // Every truncation is detected.
+  for (size_t size = 5; size < encoding.size(); ++size) {
+    EXPECT_EQ(CORRUPTED,
+              DecodeBinary(encoding.data(), size, MAX_DEPTH).error_code())
+        << "truncated to " << size;
+    EXPECT_EQ(CORRUPTED,
+              BinaryView::Open(encoding.data(), size, MAX_DEPTH)
+              .error_code())
+        << "truncated to " << size;
+  }
+
+  std::string trailing = encoding + "x";
+  EXPECT_EQ(CORRUPTED,
+            DecodeBinary(trailing.data(), trailing.size(), MAX_DEPTH)
+            .error_code());
+
+  // A symbol referring to a string past the end of the table.
+  std::vector<AST> forms;
+  forms.push_back(AST::Symbol("a"));
+  std::string bad_index = EncodeBinary(forms);
+  bad_index.back() = 5;
+  EXPECT_EQ(CORRUPTED,
+            DecodeBinary(bad_index.data(), bad_index.size(), MAX_DEPTH)
+            .error_code());
+  EXPECT_EQ(CORRUPTED,
+            BinaryView::Open(bad_index.data(), bad_index.size(), MAX_DEPTH)
+            .error_code());
+
+  // Lists whose size does not match their children, which a view would
+  // skip to the wrong place: (1 (2)) encodes to
+  // <5 2 7> <4 2> <5 1 2> <4 4> with no strings.
+  forms.clear();
+  forms.push_back(AST::Vector(AST::Integer(1),
+                              AST::Vector(AST::Integer(2))));
+  std::string encoding_of_lists = EncodeBinary(forms);
+  std::string nodes = encoding_of_lists.substr(encoding_of_lists.size() - 10);
+  ASSERT_EQ(std::string("\x05\x02\x07\x04\x02\x05\x01\x02\x04\x04", 10),
+            nodes);
+  for (size_t position : {2, 7}) {
+    for (char size : {-1, 1}) {
+      std::string bad_size = encoding_of_lists;
+      bad_size[bad_size.size() - 10 + position] += size;
+      EXPECT_EQ(CORRUPTED,
+                DecodeBinary(bad_size.data(), bad_size.size(), MAX_DEPTH)
+                .error_code());
+      EXPECT_EQ(CORRUPTED,
+                BinaryView::Open(bad_size.data(), bad_size.size(), MAX_DEPTH)
+                .error_code());
+    }
+  }
+}
+
+TEST(BinaryView, ReadTest) {
+  std::vector<AST> forms = MakeForms();
+  std::string encoding = EncodeBinary(forms);
+  auto view = BinaryView::Open(encoding.data(), encoding.size(), MAX_DEPTH);
+  ASSERT_TRUE(view.ok());
+  EXPECT_EQ(4u, view.value().num_forms());
+
+  BinaryCursor cursor = view.value().forms();
+  BinaryNode form;
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(AST::LIST, form.type());
+  EXPECT_EQ(7u, form.size());
+
+  BinaryCursor children = form.children();
+  BinaryNode child;
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(AST::SYMBOL, child.type());
+  EXPECT_EQ("defun", child.AsString());
+  // Strings point into the encoding.
+  EXPECT_LE(encoding.data(), child.AsString().data());
+  EXPECT_GT(encoding.data() + encoding.size(), child.AsString().data());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(AST::KEYWORD, child.type());
+  EXPECT_EQ(":key", child.AsString());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(AST::EVAL_FORM, child.type());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(AST::STRING, child.type());
+  EXPECT_EQ("a string longer than the inline capacity", child.AsString());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ("", child.AsString());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(0u, child.size());
+  ASSERT_TRUE(children.Next(&child));
+  EXPECT_EQ(forms[0].AsVector()[6], child.Materialize());
+  EXPECT_FALSE(children.Next(&child));
+
+  // The list is skipped without reading its children.
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(AST::FLOAT, form.type());
+  EXPECT_EQ(-1.5, form.AsDouble());
+  EXPECT_EQ(0u, form.size());
+  EXPECT_FALSE(form.children().Next(&child));
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(1e300, form.AsDouble());
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(AST::Symbol("defun"), form.Materialize());
+  EXPECT_FALSE(cursor.Next(&form));
+
+  cursor = view.value().forms();
+  for (const AST &expected : forms) {
+    ASSERT_TRUE(cursor.Next(&form));
+    EXPECT_EQ(expected, form.Materialize());
+  }
+}
+
+TEST(BinaryView, IntegerTest) {
+  std::vector<AST> forms;
+  for (int64_t value : {int64_t(0), int64_t(-1), int64_t(300),
+                        std::numeric_limits<int64_t>::min(),
+                        std::numeric_limits<int64_t>::max()}) {
+    forms.push_back(AST::Integer(value));
+  }
+  std::string encoding = EncodeBinary(forms);
+  auto view = BinaryView::Open(encoding.data(), encoding.size(), MAX_DEPTH);
+  ASSERT_TRUE(view.ok());
+
+  BinaryCursor cursor = view.value().forms();
+  BinaryNode form;
+  for (const AST &expected : forms) {
+    ASSERT_TRUE(cursor.Next(&form));
+    EXPECT_EQ(AST::INTEGER, form.type());
+    EXPECT_EQ(expected.AsInt64(), form.AsInt64());
+  }
+  EXPECT_FALSE(cursor.Next(&form));
+}
+
+}  // namespace lisparser
@@ -0,0 +1,205 @@
+#include "buffer_tokenizer.h"
+
+#include "util/char_ops.h"
+#include "util/number.h"
+#include "util/scan.h"
+
+namespace lisparser {
+
+TokenView BufferTokenizer::Next() {
+  do {
+    // Consume the skippers.
+    _position = util::scan::SkipWhitespace(_data, _position, _size);
+
+    int peek = Peek();
+
+    // Skip comments, including the line break that ends them.
+    if (peek == ';') {
+      _position = util::scan::FindLineEnd(_data, _position, _size);
+      if (_position < _size) ++_position;
+      continue;
+    }
+
+    size_t start = _position;
+
+    // Standard LL(1) parser pattern with 1-character dispatcher.
+    switch (peek) {
+      case EOF:
+        return TokenView(Token::TERMINATOR, std::string_view(), start, 0);
+
+      case '(':
+        ++_position;
+        return TokenView(Token::OPEN_PAREN, std::string_view(), start, 1);
+
+      case ')':
+        ++_position;
+        return TokenView(Token::CLOSE_PAREN, std::string_view(), start, 1);
+
+      case ',':
+        ++_position;
+        return TokenView(Token::COMMA, std::string_view(), start, 1);
+
+      case ':':
+        return MakeKeyword();
+
+      case '"':
+        return MakeString();
+
+      default:
+        if (util::char_ops::Digit(peek) || peek == '.' || peek == '-') {
+          return MakeNumber();
+        } else if (util::char_ops::SymbolCharacter(peek)) {
+          return MakeSymbol();
+        }
+
+        ++_position;
+        return TokenView(Token::INVALID_TOKEN,
+                         std::string_view(_data + start, 1), start, 1);
+    }
+  } while (true);
+}
+
+std::string_view BufferTokenizer::ConsumeSymbolCharacters(size_t start) {
+  bool has_upper = false;
+  _position = util::scan::FindSymbolEnd(_data, _position, _size,
+                                        &has_upper);
+
+  if (!has_upper) {
+    return std::string_view(_data + start, _position - start);
+  }
+
+  _scratch.resize(_position - start);
+  util::scan::LowerCase(_data + start, _position - start, &_scratch[0]);
+  return _scratch;
+}
+
+TokenView BufferTokenizer::MakeKeyword() {
+  size_t start = _position++;
+  std::string_view value = ConsumeSymbolCharacters(start);
+
+  if (value.size() == 1) {
+    return TokenView(Token::INVALID_TOKEN,
+                     "Empty keyword with single colon.", start, 1);
+  }
+
+  return TokenView(Token::KEYWORD, value, start, _position - start);
+}
+
+TokenView BufferTokenizer::MakeSymbol() {
+  size_t start = _position;
+  std::string_view value = ConsumeSymbolCharacters(start);
+  return TokenView(Token::SYMBOL, value, start, _position - start);
+}
+
+TokenView BufferTokenizer::MakeString() {
+  size_t start = _position++;
+  size_t content_start = _position;
+
+  // Fast path: strings without escapes are returned as a view into the
+  // source.
+  _position = util::scan::FindQuoteOrBackslash(_data, _position, _size);
+
+  if (Peek() == '"') {
+    ++_position;
+    return TokenView(
+        Token::STRING,
+        std::string_view(_data + content_start,
+                         _position - 1 - content_start),
+        start, _position - start);
+  }
+
+  // Slow path: unescape into the scratch storage, copying the runs
+  // between escapes in bulk.
+  _scratch.clear();
+  size_t run_start = content_start;
+  do {
+    switch (Peek()) {
+      case EOF:
+        return TokenView(Token::INVALID_TOKEN,
+                         "Unclosed string: end-of-file reached.",
+                         start, _position - start);
+      case '"':
+        _scratch.append(_data + run_start, _position - run_start);
+        ++_position;
+        return TokenView(Token::STRING, _scratch,
+                         start, _position - start);
+
+      case '\\': {
+        _scratch.append(_data + run_start, _position - run_start);
+        ++_position;
+        int escaped = Peek();
+        if (escaped != '"' && escaped != '\\') {
+          return TokenView(Token::INVALID_TOKEN,
+                           "Invalid escape character in string.",
+                           start, _position - start);
+        }
+        _scratch.push_back(static_cast<char>(escaped));
+        ++_position;
+        run_start = _position;
+        break;
+      }
+    }
+    _position = util::scan::FindQuoteOrBackslash(_data, _position, _size);
+  } while (true);
+}
+
+TokenView BufferTokenizer::MakeNumber() {
+  size_t start = _position;
+  bool dot = false;
+  bool negative = false;
+  // The integer value is accumulated along the way, so that only floats
+  // have to be converted afterwards.
+  uint64_t magnitude = 0;
+  bool in_range = true;
+
+  if (Peek() == '-') {
+    ++_position;
+    negative = true;
+  }
+
+  int peek;
+  while ((peek = Peek()) != EOF) {
+    if (util::char_ops::Digit(peek)) {
+      in_range = in_range &&
+          util::number::AppendDigit(&magnitude, peek - '0');
+      ++_position;
+    } else if (peek == '.') {
+      if (dot) return TokenView(Token::INVALID_TOKEN,
+                                "Number with more than one dot.",
+                                start, _position - start);
+      dot = true;
+      ++_position;
+    } else if (peek == '-') {
+      return TokenView(Token::INVALID_TOKEN, "Excessive minus sign.",
+                       start, _position - start);
+    } else {
+      break;
+    }
+  }
+
+  std::string_view value(_data + start, _position - start);
+
+  if (value.size() == 1 && (value[0] == '.' || value[0] == '-')) {
+    return TokenView(Token::INVALID_TOKEN,
+                     "Number with nothing but dot/minus sign.",
+                     start, _position - start);
+  }
+
+  TokenView token(dot ? Token::FLOAT : Token::INTEGER, value,
+                  start, _position - start);
+  if (dot) {
+    std::errc error = util::number::ParseDouble(value, &token.real);
+    if (error == std::errc::invalid_argument) {
+      return TokenView(Token::INVALID_TOKEN, "Malformed number.",
+                       start, _position - start);
+    }
+    in_range = error == std::errc();
+  } else {
+    in_range = in_range &&
+        util::number::ToInt64(magnitude, negative, &token.integer);
+  }
+  if (!in_range) token.type = Token::NUMBER_OUT_OF_RANGE;
+  return token;
+}
+
+}  // namespace lisparser
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "token.h"
+
+namespace lisparser {
+
+// BufferTokenizer produces the same token stream as Tokenizer, but
+// works directly on a contiguous buffer and returns TokenViews into it
+// instead of copying every token into a std::string.
+//
+// The buffer is not copied. The caller either keeps it alive for the
+// lifetime of the tokenizer, or hands over an owner object that the
+// tokenizer holds on to.
+class BufferTokenizer {
+ public:
+  BufferTokenizer(const char *data, size_t size,
+                  std::shared_ptr<const void> owner = nullptr)
+      : _data(data), _size(size), _position(0),
+        _scratch(), _owner(std::move(owner)) {}
+
+  TokenView Next();
+
+  // Starts over at the beginning of another buffer, which the caller
+  // keeps alive, and drops the previous owner. The scratch storage is
+  // kept, with its capacity.
+  inline void Reset(const char *data, size_t size) {
+    _data = data;
+    _size = size;
+    _position = 0;
+    _owner.reset();
+  }
+
+  // Continues from the given offset, which has to be between two tokens.
+  inline void Seek(size_t position) {
+    _position = position;
+  }
+
+  inline size_t position() const {
+    return _position;
+  }
+
+  inline const char *data() const {
+    return _data;
+  }
+
+  inline size_t size() const {
+    return _size;
+  }
+
+ private:
+  BufferTokenizer(const BufferTokenizer&) = delete;
+  BufferTokenizer(BufferTokenizer&&) = delete;
+  const BufferTokenizer &operator=(const BufferTokenizer&) = delete;
+  const BufferTokenizer &operator=(BufferTokenizer&&) = delete;
+
+  TokenView MakeKeyword();
+  TokenView MakeSymbol();
+  TokenView MakeString();
+  TokenView MakeNumber();
+
+  // Returns a view of the symbol characters starting at the current
+  // position (which is advanced past them), lower cased into the
+  // scratch storage if needed.
+  std::string_view ConsumeSymbolCharacters(size_t start);
+
+  inline int Peek() const {
+    return _position < _size ?
+        static_cast<unsigned char>(_data[_position]) : EOF;
+  }
+
+  const char *_data;
+  size_t _size;
+  size_t _position;
+  // Storage for rewritten tokens, reused across calls to Next().
+  std::string _scratch;
+  std::shared_ptr<const void> _owner;
+};
+
+}  // namespace lisparser
@@ -0,0 +1,115 @@
+#include "buffer_tokenizer.h"
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tokenizer.h"
+
+namespace lisparser {
+
+namespace {
+// Runs both tokenizers over the code and checks that they agree on
+// every token, including the error messages of invalid tokens.
+void ExpectSameAsStreamTokenizer(const std::string &code) {
+  Tokenizer stream_tokenizer(code);
+  BufferTokenizer buffer_tokenizer(code.data(), code.size());
+
+  do {
+    Token expected = stream_tokenizer.Next();
+    TokenView actual = buffer_tokenizer.Next();
+    EXPECT_EQ(expected.type, actual.type) << "in " << code;
+    if (expected.type == Token::INTEGER) {
+      EXPECT_EQ(expected.integer, actual.integer) << "in " << code;
+    } else if (expected.type == Token::FLOAT) {
+      EXPECT_EQ(expected.real, actual.real) << "in " << code;
+    } else {
+      EXPECT_EQ(expected.value, actual.value) << "in " << code;
+    }
+    if (expected.type == Token::TERMINATOR) break;
+  } while (true);
+}
+}  // namespace
+
+TEST(BufferTokenizer, ParenTest) {
+  std::string code = "(( ) )";
+  BufferTokenizer tokenizer(code.data(), code.size());
+
+  EXPECT_EQ(TokenView(Token::OPEN_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::OPEN_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::CLOSE_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::CLOSE_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::TERMINATOR), tokenizer.Next());
+}
+
+TEST(BufferTokenizer, ZeroCopyTest) {
+  std::string code = "(abc :key \"str\" 12.5)";
+  BufferTokenizer tokenizer(code.data(), code.size());
+
+  EXPECT_EQ(TokenView(Token::OPEN_PAREN), tokenizer.Next());
+
+  TokenView symbol = tokenizer.Next();
+  EXPECT_EQ(TokenView(Token::SYMBOL, "abc"), symbol);
+  EXPECT_EQ(code.data() + 1, symbol.value.data());
+  EXPECT_EQ(1, symbol.offset);
+  EXPECT_EQ(3, symbol.length);
+
+  TokenView keyword = tokenizer.Next();
+  EXPECT_EQ(TokenView(Token::KEYWORD, ":key"), keyword);
+  EXPECT_EQ(code.data() + 5, keyword.value.data());
+
+  TokenView string = tokenizer.Next();
+  EXPECT_EQ(TokenView(Token::STRING, "str"), string);
+  EXPECT_EQ(code.data() + 11, string.value.data());
+  EXPECT_EQ(10, string.offset);
+  EXPECT_EQ(5, string.length);
+
+  TokenView number = tokenizer.Next();
+  EXPECT_EQ(TokenView(Token::FLOAT, "12.5"), number);
+  EXPECT_EQ(code.data() + 16, number.value.data());
+
+  EXPECT_EQ(TokenView(Token::CLOSE_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::TERMINATOR), tokenizer.Next());
+}
+
+TEST(BufferTokenizer, RewrittenTokenTest) {
+  std::string code = "Defmethod :Nice-Keyword \"a \\\"b\\\\\"";
+  BufferTokenizer tokenizer(code.data(), code.size());
+
+  EXPECT_EQ(TokenView(Token::SYMBOL, "defmethod"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::KEYWORD, ":nice-keyword"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::STRING, "a \"b\\"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::TERMINATOR), tokenizer.Next());
+}
+
+TEST(BufferTokenizer, SameAsStreamTokenizerTest) {
+  std::vector<std::string> codes = {
+    "(:a (:Nice-Keyword))",
+    ":,", ":",
+    "\"haha\"", "\"\"", "(\"ha(h-a\")",
+    "(\"I have space, (\\\\) and \\\"escapes\\\"\")",
+    "\"unclosed", "\"bad \\escape\"", "\"escape at end\\",
+    "Comma, and \",\"",
+    "(Defmethod a (B \"C\" D))", "A1b2C3",
+    "(12 (11.52))", ".23 -15 a-b (-.88",
+    "9223372036854775807 -9223372036854775808 0.1 -0.000001",
+    "9223372036854775808 -9223372036854775809 99999999999999999999999",
+    std::string(400, '9') + ".5",
+    "a . b", "15.8.9", "-", "-..", "-. -.1.", "1-2", "12abc",
+    "a b ;; haha \n c ;; comment again",
+    "a;b 'quoted \x01 \xe9t\xe9",
+    // Long enough for the vectorized scanning kernels.
+    "(a-very-long-symbol-name-in-lower-case-only "
+    "A-Very-Long-Symbol-Name-In-Mixed-Case-Exceeding-Thirty-Two\t\t\t\t"
+    "                                                   :Long-Keyword"
+    "\"a long string without any escape in it at all, really\" "
+    "\"a long string with \\\"escapes\\\" in the middle and the end\\\\\""
+    ";; a long comment that goes on and on and on and on and on\n"
+    "last)",
+  };
+
+  for (const std::string &code : codes) {
+    ExpectSameAsStreamTokenizer(code);
+  }
+}
+
+}  // namespace lisparser
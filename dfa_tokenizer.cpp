@@ -0,0 +1,286 @@
+#include "dfa_tokenizer.h"
+
+#include <array>
+#include <cstdint>
+#include "util/char_ops.h"
+#include "util/number.h"
+
+namespace lisparser {
+
+namespace {
+
+using util::char_ops::CharClass;
+
+enum State : uint8_t {
+  START = 0,
+  COMMENT,
+  // Right after the colon.
+  KEYWORD_EMPTY,
+  KEYWORD,
+  SYMBOL,
+  STRING,
+  STRING_ESCAPE,
+  // Numbers, after "-", ".", "-." and so on.
+  MINUS,
+  DOT,
+  MINUS_DOT,
+  INTEGER,
+  FRACTION,
+
+  NUM_STATES,
+
+  // Final states, which end Next(). Only the ones listed in CONSUMES
+  // consume the current character.
+  EMIT_OPEN_PAREN = NUM_STATES,
+  EMIT_CLOSE_PAREN,
+  EMIT_COMMA,
+  EMIT_KEYWORD,
+  EMIT_SYMBOL,
+  EMIT_STRING,
+  EMIT_INTEGER,
+  EMIT_FLOAT,
+  EMIT_TERMINATOR,
+  ERROR_INVALID_CHARACTER,
+  ERROR_EMPTY_KEYWORD,
+  ERROR_UNCLOSED_STRING,
+  ERROR_INVALID_ESCAPE,
+  ERROR_MORE_THAN_ONE_DOT,
+  ERROR_EXCESSIVE_MINUS,
+  ERROR_NOTHING_BUT_DOT_OR_MINUS,
+};
+
+constexpr bool IsSymbolClass(CharClass char_class) {
+  return char_class >= util::char_ops::BACKSLASH &&
+      char_class <= util::char_ops::SYMBOL;
+}
+
+// The states numbers are in after their first character.
+constexpr State NumberTransition(State state, CharClass char_class,
+                                 State otherwise) {
+  switch (char_class) {
+    case util::char_ops::DIGIT:
+      return (state == INTEGER || state == MINUS) ? INTEGER : FRACTION;
+    case util::char_ops::DOT:
+      return state == INTEGER ? FRACTION :
+          state == MINUS ? MINUS_DOT : ERROR_MORE_THAN_ONE_DOT;
+    case util::char_ops::MINUS:
+      return ERROR_EXCESSIVE_MINUS;
+    default:
+      return otherwise;
+  }
+}
+
+constexpr State Transition(State state, CharClass char_class) {
+  switch (state) {
+    case START:
+      switch (char_class) {
+        case util::char_ops::WHITESPACE: return START;
+        case util::char_ops::LINE_END: return START;
+        case util::char_ops::OPEN_PAREN: return EMIT_OPEN_PAREN;
+        case util::char_ops::CLOSE_PAREN: return EMIT_CLOSE_PAREN;
+        case util::char_ops::COMMA: return EMIT_COMMA;
+        case util::char_ops::QUOTE: return STRING;
+        case util::char_ops::SEMICOLON: return COMMENT;
+        case util::char_ops::COLON: return KEYWORD_EMPTY;
+        case util::char_ops::DIGIT: return INTEGER;
+        case util::char_ops::DOT: return DOT;
+        case util::char_ops::MINUS: return MINUS;
+        case util::char_ops::BACKSLASH: return SYMBOL;
+        case util::char_ops::UPPER: return SYMBOL;
+        case util::char_ops::SYMBOL: return SYMBOL;
+        case util::char_ops::INVALID: return ERROR_INVALID_CHARACTER;
+        case util::char_ops::END: return EMIT_TERMINATOR;
+      }
+      return ERROR_INVALID_CHARACTER;
+
+    case COMMENT:
+      // The end of the input does not consume anything, and therefore
+      // cannot go back to START.
+      return char_class == util::char_ops::LINE_END ? START :
+          char_class == util::char_ops::END ? EMIT_TERMINATOR : COMMENT;
+
+    case KEYWORD_EMPTY:
+      return IsSymbolClass(char_class) ? KEYWORD : ERROR_EMPTY_KEYWORD;
+
+    case KEYWORD:
+      return IsSymbolClass(char_class) ? KEYWORD : EMIT_KEYWORD;
+
+    case SYMBOL:
+      return IsSymbolClass(char_class) ? SYMBOL : EMIT_SYMBOL;
+
+    case STRING:
+      return char_class == util::char_ops::QUOTE ? EMIT_STRING :
+          char_class == util::char_ops::BACKSLASH ? STRING_ESCAPE :
+          char_class == util::char_ops::END ? ERROR_UNCLOSED_STRING : STRING;
+
+    case STRING_ESCAPE:
+      return (char_class == util::char_ops::QUOTE ||
+              char_class == util::char_ops::BACKSLASH) ?
+          STRING : ERROR_INVALID_ESCAPE;
+
+    case MINUS:
+    case DOT:
+      return NumberTransition(state, char_class,
+                              ERROR_NOTHING_BUT_DOT_OR_MINUS);
+
+    case MINUS_DOT:
+    case FRACTION:
+      return NumberTransition(state, char_class, EMIT_FLOAT);
+
+    case INTEGER:
+      return NumberTransition(state, char_class, EMIT_INTEGER);
+
+    default:
+      return ERROR_INVALID_CHARACTER;
+  }
+}
+
+using TransitionTable = std::array<
+  std::array<State, util::char_ops::NUM_CHAR_CLASSES>, NUM_STATES>;
+
+constexpr TransitionTable MakeTransitionTable() {
+  TransitionTable table {};
+  for (int state = 0; state < NUM_STATES; ++state) {
+    for (int char_class = 0; char_class < util::char_ops::NUM_CHAR_CLASSES;
+         ++char_class) {
+      table[state][char_class] = Transition(
+          static_cast<State>(state), static_cast<CharClass>(char_class));
+    }
+  }
+  return table;
+}
+
+constexpr TransitionTable TRANSITIONS = MakeTransitionTable();
+
+constexpr bool Consumes(State state) {
+  return state == EMIT_OPEN_PAREN || state == EMIT_CLOSE_PAREN ||
+      state == EMIT_COMMA || state == EMIT_STRING ||
+      state == ERROR_INVALID_CHARACTER;
+}
+
+constexpr Token::Type EmittedType(State state) {
+  switch (state) {
+    case EMIT_OPEN_PAREN: return Token::OPEN_PAREN;
+    case EMIT_CLOSE_PAREN: return Token::CLOSE_PAREN;
+    case EMIT_COMMA: return Token::COMMA;
+    case EMIT_KEYWORD: return Token::KEYWORD;
+    case EMIT_SYMBOL: return Token::SYMBOL;
+    case EMIT_STRING: return Token::STRING;
+    case EMIT_INTEGER: return Token::INTEGER;
+    case EMIT_FLOAT: return Token::FLOAT;
+    case EMIT_TERMINATOR: return Token::TERMINATOR;
+    default: return Token::INVALID_TOKEN;
+  }
+}
+
+constexpr const char *ErrorMessage(State state) {
+  switch (state) {
+    case ERROR_EMPTY_KEYWORD:
+      return "Empty keyword with single colon.";
+    case ERROR_UNCLOSED_STRING:
+      return "Unclosed string: end-of-file reached.";
+    case ERROR_INVALID_ESCAPE:
+      return "Invalid escape character in string.";
+    case ERROR_MORE_THAN_ONE_DOT:
+      return "Number with more than one dot.";
+    case ERROR_EXCESSIVE_MINUS:
+      return "Excessive minus sign.";
+    case ERROR_NOTHING_BUT_DOT_OR_MINUS:
+      return "Number with nothing but dot/minus sign.";
+    default:
+      return "";
+  }
+}
+
+}  // namespace
+
+TokenView DfaTokenizer::Next() {
+  State state = START;
+  size_t start = _position;
+  bool has_upper = false;
+  bool has_escape = false;
+
+  do {
+    CharClass char_class = _position < _size ?
+        util::char_ops::CLASS_TABLE[
+            static_cast<unsigned char>(_data[_position])] :
+        util::char_ops::END;
+    State next = TRANSITIONS[state][char_class];
+
+    // Tokens start at the first character that leaves START (or
+    // COMMENT, which only ends with the input).
+    if (state == START || state == COMMENT) start = _position;
+
+    if (next >= NUM_STATES) {
+      state = next;
+      break;
+    }
+
+    has_upper |= char_class == util::char_ops::UPPER;
+    has_escape |= next == STRING_ESCAPE;
+    state = next;
+    ++_position;
+  } while (true);
+
+  if (Consumes(state)) ++_position;
+
+  size_t length = _position - start;
+  Token::Type type = EmittedType(state);
+
+  switch (state) {
+    case EMIT_KEYWORD:
+    case EMIT_SYMBOL: {
+      std::string_view value(_data + start, length);
+      if (!has_upper) return TokenView(type, value, start, length);
+      _scratch.resize(length);
+      for (size_t i = 0; i < length; ++i) {
+        _scratch[i] = util::char_ops::ToLower(value[i]);
+      }
+      return TokenView(type, _scratch, start, length);
+    }
+
+    case EMIT_STRING: {
+      std::string_view content(_data + start + 1, length - 2);
+      if (!has_escape) return TokenView(type, content, start, length);
+      // The automaton has already validated the escapes.
+      _scratch.clear();
+      for (size_t i = 0; i < content.size(); ++i) {
+        if (content[i] == '\\') ++i;
+        _scratch.push_back(content[i]);
+      }
+      return TokenView(type, _scratch, start, length);
+    }
+
+    case EMIT_INTEGER:
+    case EMIT_FLOAT: {
+      TokenView token(type, std::string_view(_data + start, length),
+                      start, length);
+      std::errc error = std::errc();
+      if (state == EMIT_FLOAT) {
+        error = util::number::ParseDouble(token.value, &token.real);
+      } else if (!util::number::ParseInteger(token.value, &token.integer)) {
+        error = std::errc::result_out_of_range;
+      }
+      if (error == std::errc::invalid_argument) {
+        return TokenView(Token::INVALID_TOKEN, "Malformed number.",
+                         start, length);
+      }
+      if (error != std::errc()) token.type = Token::NUMBER_OUT_OF_RANGE;
+      return token;
+    }
+
+    case ERROR_INVALID_CHARACTER:
+      return TokenView(type, std::string_view(_data + start, 1), start, 1);
+
+    case EMIT_OPEN_PAREN:
+    case EMIT_CLOSE_PAREN:
+    case EMIT_COMMA:
+    case EMIT_TERMINATOR:
+      return TokenView(type, std::string_view(), start, length);
+
+    default:
+      return TokenView(type, ErrorMessage(state), start, length);
+  }
+}
+
+}  // namespace lisparser
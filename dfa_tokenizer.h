@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "token.h"
+
+namespace lisparser {
+
+// DfaTokenizer is an alternative engine to BufferTokenizer that produces
+// the same token stream. Instead of dispatching on characters with
+// branches, it runs a deterministic finite automaton driven by two
+// constexpr tables: one that maps each of the 256 byte values to a
+// character class, and one that maps (state, character class) to the
+// next state. Neither depends on the current locale.
+class DfaTokenizer {
+ public:
+  DfaTokenizer(const char *data, size_t size,
+               std::shared_ptr<const void> owner = nullptr)
+      : _data(data), _size(size), _position(0),
+        _scratch(), _owner(std::move(owner)) {}
+
+  TokenView Next();
+
+  inline const char *data() const {
+    return _data;
+  }
+
+  inline size_t size() const {
+    return _size;
+  }
+
+ private:
+  DfaTokenizer(const DfaTokenizer&) = delete;
+  DfaTokenizer(DfaTokenizer&&) = delete;
+  const DfaTokenizer &operator=(const DfaTokenizer&) = delete;
+  const DfaTokenizer &operator=(DfaTokenizer&&) = delete;
+
+  const char *_data;
+  size_t _size;
+  size_t _position;
+  // Storage for rewritten tokens, reused across calls to Next().
+  std::string _scratch;
+  std::shared_ptr<const void> _owner;
+};
+
+}  // namespace lisparser
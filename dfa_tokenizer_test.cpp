@@ -0,0 +1,89 @@
+#include "dfa_tokenizer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tokenizer.h"
+
+namespace lisparser {
+
+namespace {
+void ExpectSameAsStreamTokenizer(const std::string &code) {
+  Tokenizer stream_tokenizer(code);
+  DfaTokenizer dfa_tokenizer(code.data(), code.size());
+
+  do {
+    Token expected = stream_tokenizer.Next();
+    TokenView actual = dfa_tokenizer.Next();
+    ASSERT_EQ(expected.type, actual.type) << "in " << code;
+    if (expected.type == Token::INTEGER) {
+      EXPECT_EQ(expected.integer, actual.integer) << "in " << code;
+    } else if (expected.type == Token::FLOAT) {
+      EXPECT_EQ(expected.real, actual.real) << "in " << code;
+    } else {
+      ASSERT_EQ(expected.value, actual.value) << "in " << code;
+    }
+    if (expected.type == Token::TERMINATOR) break;
+  } while (true);
+}
+}  // namespace
+
+TEST(DfaTokenizer, TokenTest) {
+  std::string code = "(Defmethod :Key (\"a \\\"b\\\\\" 12 -.5)) ; done";
+  DfaTokenizer tokenizer(code.data(), code.size());
+
+  EXPECT_EQ(TokenView(Token::OPEN_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::SYMBOL, "defmethod"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::KEYWORD, ":key"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::OPEN_PAREN), tokenizer.Next());
+
+  TokenView string = tokenizer.Next();
+  EXPECT_EQ(TokenView(Token::STRING, "a \"b\\"), string);
+  EXPECT_EQ(17, string.offset);
+  EXPECT_EQ(9, string.length);
+
+  EXPECT_EQ(TokenView(Token::INTEGER, "12"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::FLOAT, "-.5"), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::CLOSE_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::CLOSE_PAREN), tokenizer.Next());
+  EXPECT_EQ(TokenView(Token::TERMINATOR), tokenizer.Next());
+}
+
+TEST(DfaTokenizer, SameAsStreamTokenizerTest) {
+  std::vector<std::string> codes = {
+    "(( ) )", "(:a (:Nice-Keyword))", ":,", ":",
+    "\"haha\"", "\"\"", "(\"ha(h-a\")",
+    "(\"I have space, (\\\\) and \\\"escapes\\\"\")",
+    "\"unclosed", "\"bad \\escape\"", "\"escape at end\\",
+    "Comma, and \",\"", "(Defmethod a (B \"C\" D))", "A1b2C3",
+    "(12 (11.52))", ".23 -15 a-b (-.88",
+    "9223372036854775807 -9223372036854775808 0.1 -0.000001",
+    "9223372036854775808 -9223372036854775809 99999999999999999999999",
+    std::string(400, '9') + ".5", "-. -.1.",
+    "a . b", "15.8.9", "-", "-..", "1-2", "12abc", "--1", ".-",
+    "a b ;; haha \n c ;; comment again", "; only a comment",
+    "a;b 'quoted \x01 \xe9t\xe9",
+  };
+
+  for (const std::string &code : codes) {
+    ExpectSameAsStreamTokenizer(code);
+  }
+}
+
+TEST(DfaTokenizer, RandomInputTest) {
+  const std::string alphabet = " \n\t()\",;:\\'.-09aZ\x80";
+  std::mt19937 engine(4180);
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+
+  for (int round = 0; round < 2000; ++round) {
+    std::string code;
+    size_t length = engine() % 24;
+    for (size_t i = 0; i < length; ++i) {
+      code.push_back(alphabet[pick(engine)]);
+    }
+    ExpectSameAsStreamTokenizer(code);
+  }
+}
+
+}  // namespace lisparser
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "parser_stats.h"
+#include "token.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+// The error codes and limits shared by all the parsers.
+class ParserBase {
+ public:
+  enum ParserError {
+    EMPTY = 1,
+    TOKENIZER_EXCEPTION = 2,
+    BAD_EVAL_FORM = 3,
+    UNMATCHED_PAREN = 4,
+    IO_ERROR = 5,
+    TOO_DEEP = 6,
+    // An integer that does not fit in int64_t, or a float that does not
+    // fit in double.
+    OUT_OF_RANGE = 7,
+  };
+
+  // Lists nested deeper than this are rejected with TOO_DEEP by default.
+  // Note that destroying, copying and comparing ASTs recurse on their
+  // depth, so threads with small stacks should lower it.
+  static constexpr size_t DEFAULT_MAX_DEPTH = 10000;
+};
+
+static_assert(ParserBase::OUT_OF_RANGE < ParserStats::NUM_ERROR_CODES,
+              "ParserStats counts the errors by code.");
+static_assert(Token::INTEGER < ParserStats::NUM_TOKEN_TYPES,
+              "ParserStats counts the tokens by type.");
+
+// EventParser reports the forms read by the tokenizer as a sequence of
+// calls to a handler instead of building ASTs, for the consumers that
+// only scan through them. The handler is any class with the methods
+//
+//   void OnListBegin();
+//   void OnListEnd();
+//   void OnSymbol(std::string_view name);
+//   void OnKeyword(std::string_view name);
+//   void OnEvalForm(std::string_view name);
+//   void OnString(std::string_view value);
+//   void OnInteger(int64_t value);
+//   void OnDouble(double value);
+//
+// which are resolved at compile time. The views are only valid during
+// the call. TokenizerType is either Tokenizer or BufferTokenizer.
+template <typename TokenizerType>
+class EventParser : public ParserBase {
+ public:
+  // Takes the ownership of the tokenizer.
+  EventParser(TokenizerType *tokenizer)
+      : _tokenizer(tokenizer), _max_depth(DEFAULT_MAX_DEPTH),
+        _closed(false),
+        _stats(STATS_ENABLED ? new ParserStats() : nullptr) {}
+
+  // Reports the next top-level form to the handler, and returns the
+  // number of atoms and lists in it. When the form turns out to be
+  // invalid, the events reported so far are not balanced.
+  template <typename Handler>
+  util::Result<size_t> Next(Handler *handler);
+
+  // Parses another buffer from its beginning, reusing the tokenizer.
+  // Only for BufferTokenizer. The statistics keep adding up.
+  inline void Restart(const char *data, size_t size) {
+    _tokenizer->Reset(data, size);
+    _closed = false;
+  }
+
+  inline void set_max_depth(size_t max_depth) {
+    _max_depth = max_depth;
+  }
+
+  // Returns nullptr unless STATS_ENABLED.
+  inline const ParserStats *stats() const {
+    return _stats.get();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  EventParser(const EventParser&) = delete;
+  const EventParser &operator=(const EventParser&) = delete;
+
+  static inline uint64_t NanosecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+  }
+
+  template <typename Handler>
+  util::Result<size_t> Parse(Handler *handler);
+
+  auto NextToken() {
+    if constexpr (STATS_ENABLED) {
+      Clock::time_point start = Clock::now();
+      auto token = _tokenizer->Next();
+      _stats->tokenize_nanoseconds.Add(NanosecondsSince(start));
+      if (token.type < ParserStats::NUM_TOKEN_TYPES) {
+        _stats->tokens[token.type].Add(1);
+      }
+      return token;
+    } else {
+      return _tokenizer->Next();
+    }
+  }
+
+  std::unique_ptr<TokenizerType> _tokenizer;
+  size_t _max_depth;
+  bool _closed;
+  std::unique_ptr<ParserStats> _stats;
+};
+
+template <typename TokenizerType>
+template <typename Handler>
+util::Result<size_t> EventParser<TokenizerType>::Next(Handler *handler) {
+  if constexpr (STATS_ENABLED) {
+    Clock::time_point start = Clock::now();
+    util::Result<size_t> result = Parse(handler);
+    uint64_t nanoseconds = NanosecondsSince(start);
+
+    _stats->total_nanoseconds.Add(nanoseconds);
+    _stats->latency[ParserStats::LatencyBucket(nanoseconds)].Add(1);
+    _stats->bytes.Set(_tokenizer->position());
+    if (result.ok()) {
+      _stats->forms.Add(1);
+      _stats->nodes.Add(result.value());
+    } else {
+      _stats->errors[result.error_code()].Add(1);
+    }
+    return result;
+  } else {
+    return Parse(handler);
+  }
+}
+
+template <typename TokenizerType>
+template <typename Handler>
+util::Result<size_t> EventParser<TokenizerType>::Parse(Handler *handler) {
+  if (_closed) return util::Result<size_t>(EMPTY);
+
+  // Only the depth is tracked, the handler keeps whatever it needs of
+  // the enclosing lists.
+  size_t depth = 0;
+  size_t num_nodes = 0;
+
+  do {
+    auto token = NextToken();
+
+    switch (token.type) {
+      case Token::TERMINATOR:
+        _closed = true;
+        return util::Result<size_t>(depth > 0 ? UNMATCHED_PAREN : EMPTY);
+
+      case Token::INVALID_TOKEN:
+        _closed = true;
+        return util::Result<size_t>(TOKENIZER_EXCEPTION,
+                                    std::string(token.value));
+
+      case Token::KEYWORD:
+        handler->OnKeyword(token.value);
+        break;
+
+      case Token::SYMBOL:
+        handler->OnSymbol(token.value);
+        break;
+
+      case Token::STRING:
+        handler->OnString(token.value);
+        break;
+
+      case Token::COMMA:
+        token = NextToken();
+        if (token.type != Token::SYMBOL) {
+          return util::Result<size_t>(BAD_EVAL_FORM);
+        }
+        handler->OnEvalForm(token.value);
+        break;
+
+      case Token::FLOAT:
+        handler->OnDouble(token.real);
+        break;
+
+      case Token::INTEGER:
+        handler->OnInteger(token.integer);
+        break;
+
+      case Token::NUMBER_OUT_OF_RANGE:
+        _closed = true;
+        return util::Result<size_t>(
+            OUT_OF_RANGE, util::StrCat("Number out of range: ", token.value));
+
+      case Token::OPEN_PAREN:
+        if (depth >= _max_depth) {
+          _closed = true;
+          return util::Result<size_t>(
+              TOO_DEEP,
+              util::StrCat("Nesting deeper than ", _max_depth, " levels."));
+        }
+        ++depth;
+        ++num_nodes;
+        if constexpr (STATS_ENABLED) _stats->max_depth.Max(depth);
+        handler->OnListBegin();
+        continue;
+
+      case Token::CLOSE_PAREN:
+        if (depth > 0) {
+          --depth;
+          handler->OnListEnd();
+          if (depth == 0) return num_nodes;
+          continue;
+        }
+        // A closing paren without an opening one is unexpected.
+        [[fallthrough]];
+
+      default:
+        // TODO(breakds): Append the stringified token to the end of the
+        // error message.
+        return util::Result<size_t>(TOKENIZER_EXCEPTION,
+                                    "Unrecognizable token.");
+    }
+
+    ++num_nodes;
+    if (depth == 0) return num_nodes;
+  } while (true);
+}
+
+}  // namespace lisparser
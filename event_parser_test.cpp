@@ -0,0 +1,200 @@
+#include "event_parser.h"
+
+#include <memory>
+#include <string>
+#include "buffer_tokenizer.h"
+#include "gtest/gtest.h"
+#include "tokenizer.h"
+
+namespace lisparser {
+
+namespace {
+// Writes the events down as a string.
+class RecordingHandler {
+ public:
+  void OnListBegin() { events += "( "; }
+  void OnListEnd() { events += ") "; }
+  void OnSymbol(std::string_view name) { Add("sym", name); }
+  void OnKeyword(std::string_view name) { Add("kw", name); }
+  void OnEvalForm(std::string_view name) { Add("eval", name); }
+  void OnString(std::string_view value) { Add("str", value); }
+  void OnInteger(int64_t value) { Add("int", std::to_string(value)); }
+  void OnDouble(double value) { Add("dbl", std::to_string(value)); }
+
+  std::string events;
+
+ private:
+  void Add(const char *kind, std::string_view value) {
+    events += kind;
+    events += ':';
+    events += value;
+    events += ' ';
+  }
+};
+
+// Counts the top-level forms by their head symbol, without looking at
+// anything else.
+class HeadCountingHandler {
+ public:
+  HeadCountingHandler() : num_defuns(0), _depth(0), _at_head(false) {}
+
+  void OnListBegin() { _at_head = (++_depth == 1); }
+  void OnListEnd() { --_depth; _at_head = false; }
+  void OnSymbol(std::string_view name) {
+    if (_at_head && name == "defun") ++num_defuns;
+    _at_head = false;
+  }
+  void OnKeyword(std::string_view) { _at_head = false; }
+  void OnEvalForm(std::string_view) { _at_head = false; }
+  void OnString(std::string_view) { _at_head = false; }
+  void OnInteger(int64_t) { _at_head = false; }
+  void OnDouble(double) { _at_head = false; }
+
+  int num_defuns;
+
+ private:
+  int _depth;
+  bool _at_head;
+};
+}  // namespace
+
+TEST(EventParser, EventsTest) {
+  std::string code = "(Defun f (x) \"doc\" ,x :Key 12 -1.5) atom";
+  EventParser<BufferTokenizer> parser(
+      new BufferTokenizer(code.data(), code.size()));
+  RecordingHandler handler;
+
+  auto first = parser.Next(&handler);
+  ASSERT_TRUE(first.ok());
+  EXPECT_EQ(10, first.value());
+  EXPECT_EQ("( sym:defun sym:f ( sym:x ) str:doc eval:x kw::key int:12 "
+            "dbl:-1.500000 ) ",
+            handler.events);
+
+  handler.events.clear();
+  auto second = parser.Next(&handler);
+  ASSERT_TRUE(second.ok());
+  EXPECT_EQ(1, second.value());
+  EXPECT_EQ("sym:atom ", handler.events);
+
+  EXPECT_EQ(EventParser<BufferTokenizer>::EMPTY,
+            parser.Next(&handler).error_code());
+  EXPECT_EQ(EventParser<BufferTokenizer>::EMPTY,
+            parser.Next(&handler).error_code());
+}
+
+TEST(EventParser, StreamTokenizerTest) {
+  EventParser<Tokenizer> parser(new Tokenizer("(a (b)) \"c\""));
+  RecordingHandler handler;
+
+  EXPECT_TRUE(parser.Next(&handler).ok());
+  EXPECT_TRUE(parser.Next(&handler).ok());
+  EXPECT_EQ("( sym:a ( sym:b ) ) str:c ", handler.events);
+  EXPECT_EQ(ParserBase::EMPTY, parser.Next(&handler).error_code());
+}
+
+TEST(EventParser, FilterByHeadTest) {
+  std::string code;
+  for (int i = 0; i < 100; ++i) {
+    code += "(defun f (defun) \"defun\") (defvar (defun)) defun ";
+  }
+  EventParser<BufferTokenizer> parser(
+      new BufferTokenizer(code.data(), code.size()));
+  HeadCountingHandler handler;
+
+  while (parser.Next(&handler).ok()) {}
+  EXPECT_EQ(100, handler.num_defuns);
+}
+
+TEST(EventParser, ErrorTest) {
+  RecordingHandler handler;
+  {
+    EventParser<Tokenizer> parser(new Tokenizer("(a (b)"));
+    EXPECT_EQ(ParserBase::UNMATCHED_PAREN,
+              parser.Next(&handler).error_code());
+    EXPECT_EQ(ParserBase::EMPTY, parser.Next(&handler).error_code());
+  }
+  {
+    EventParser<Tokenizer> parser(new Tokenizer("(a , (b))"));
+    EXPECT_EQ(ParserBase::BAD_EVAL_FORM, parser.Next(&handler).error_code());
+  }
+  {
+    EventParser<Tokenizer> parser(new Tokenizer(") a"));
+    EXPECT_EQ(ParserBase::TOKENIZER_EXCEPTION,
+              parser.Next(&handler).error_code());
+  }
+  {
+    EventParser<Tokenizer> parser(new Tokenizer("(((a)))"));
+    parser.set_max_depth(2);
+    auto result = parser.Next(&handler);
+    EXPECT_EQ(ParserBase::TOO_DEEP, result.error_code());
+    EXPECT_EQ("Nesting deeper than 2 levels.", result.error_message());
+  }
+}
+
+TEST(EventParser, LatencyBucketTest) {
+  EXPECT_EQ(0, ParserStats::LatencyBucket(0));
+  EXPECT_EQ(1, ParserStats::LatencyBucket(1));
+  EXPECT_EQ(2, ParserStats::LatencyBucket(3));
+  EXPECT_EQ(3, ParserStats::LatencyBucket(4));
+  EXPECT_EQ(ParserStats::NUM_LATENCY_BUCKETS - 1,
+            ParserStats::LatencyBucket(~uint64_t(0)));
+}
+
+TEST(EventParser, StatsTest) {
+  for (bool stream : {false, true}) {
+    std::string code = "(a (:b \"c\")) 12 (d ((1.5)) ,e) )";
+    RecordingHandler handler;
+    std::unique_ptr<EventParser<Tokenizer>> stream_parser(
+        new EventParser<Tokenizer>(new Tokenizer(code)));
+    std::unique_ptr<EventParser<BufferTokenizer>> buffer_parser(
+        new EventParser<BufferTokenizer>(
+            new BufferTokenizer(code.data(), code.size())));
+    auto next = [&]() {
+      return stream ? stream_parser->Next(&handler) :
+          buffer_parser->Next(&handler);
+    };
+    const ParserStats *stats =
+        stream ? stream_parser->stats() : buffer_parser->stats();
+    if (!STATS_ENABLED) {
+      EXPECT_EQ(nullptr, stats);
+      continue;
+    }
+
+    ASSERT_TRUE(next().ok());
+    EXPECT_EQ(1, stats->forms.value());
+    EXPECT_EQ(5, stats->nodes.value());
+    EXPECT_EQ(2, stats->max_depth.value());
+    EXPECT_EQ(12, stats->bytes.value());
+
+    ASSERT_TRUE(next().ok());
+    ASSERT_TRUE(next().ok());
+    EXPECT_EQ(ParserBase::TOKENIZER_EXCEPTION, next().error_code());
+    EXPECT_EQ(ParserBase::EMPTY, next().error_code());
+
+    EXPECT_EQ(3, stats->forms.value());
+    EXPECT_EQ(12, stats->nodes.value());
+    EXPECT_EQ(3, stats->max_depth.value());
+    EXPECT_EQ(code.size(), stats->bytes.value());
+    EXPECT_EQ(5, stats->tokens[Token::OPEN_PAREN].value());
+    EXPECT_EQ(6, stats->tokens[Token::CLOSE_PAREN].value());
+    EXPECT_EQ(1, stats->tokens[Token::COMMA].value());
+    EXPECT_EQ(1, stats->tokens[Token::KEYWORD].value());
+    EXPECT_EQ(3, stats->tokens[Token::SYMBOL].value());
+    EXPECT_EQ(1, stats->tokens[Token::STRING].value());
+    EXPECT_EQ(1, stats->tokens[Token::FLOAT].value());
+    EXPECT_EQ(1, stats->tokens[Token::INTEGER].value());
+    EXPECT_EQ(1, stats->errors[ParserBase::TOKENIZER_EXCEPTION].value());
+    EXPECT_EQ(1, stats->errors[ParserBase::EMPTY].value());
+
+    uint64_t calls = 0;
+    for (const StatCounter &bucket : stats->latency) {
+      calls += bucket.value();
+    }
+    EXPECT_EQ(5, calls);
+    EXPECT_LE(stats->tokenize_nanoseconds.value(),
+              stats->total_nanoseconds.value());
+  }
+}
+
+}  // namespace lisparser
@@ -0,0 +1,128 @@
+#include "lazy_document.h"
+
+#include "parser.h"
+#include "structure.h"
+#include "util/mapped_file.h"
+
+namespace lisparser {
+
+LazyCursor LazyNode::children() const {
+  if (!is_list()) return LazyCursor(_document, _end, _end, _list);
+  return LazyCursor(_document, _begin + 1, _end - 1, _list + 1);
+}
+
+util::Result<LazyNode> LazyNode::Child(size_t index) const {
+  LazyCursor cursor = children();
+  do {
+    util::Result<LazyNode> child = cursor.Next();
+    if (!child.ok() || index == 0) return child;
+    --index;
+  } while (true);
+}
+
+util::Result<AST> LazyNode::Materialize(util::Arena *arena) const {
+  Parser parser(new BufferTokenizer(_document->data() + _begin,
+                                    _end - _begin));
+  if (arena != nullptr) parser.set_arena(arena);
+  return parser.Next();
+}
+
+LazyCursor::LazyCursor(const LazyDocument *document, size_t begin,
+                       size_t end, size_t next_list)
+    : _document(document), _tokenizer(document->data(), end),
+      _next_list(next_list) {
+  _tokenizer.Seek(begin);
+}
+
+util::Result<LazyNode> LazyCursor::Next() {
+  TokenView token = _tokenizer.Next();
+
+  switch (token.type) {
+    case Token::TERMINATOR:
+      return util::Result<LazyNode>(Parser::EMPTY);
+
+    case Token::INVALID_TOKEN:
+      return util::Result<LazyNode>(Parser::TOKENIZER_EXCEPTION,
+                                    std::string(token.value));
+
+    case Token::OPEN_PAREN: {
+      const std::vector<LazyDocument::ListSpan> &lists = _document->_lists;
+      // The index and the tokenizer only disagree after an invalid
+      // token that the index skipped over.
+      if (_next_list >= lists.size() ||
+          lists[_next_list].open != token.offset) {
+        return util::Result<LazyNode>(Parser::TOKENIZER_EXCEPTION,
+                                      "Unrecognizable token.");
+      }
+      const LazyDocument::ListSpan &list = lists[_next_list];
+      LazyNode node(_document, list.open, list.close + 1, _next_list);
+      _tokenizer.Seek(list.close + 1);
+      _next_list = list.next;
+      return node;
+    }
+
+    case Token::COMMA: {
+      TokenView symbol = _tokenizer.Next();
+      if (symbol.type != Token::SYMBOL) {
+        return util::Result<LazyNode>(Parser::BAD_EVAL_FORM);
+      }
+      return LazyNode(_document, token.offset, symbol.offset + symbol.length,
+                      LazyNode::NOT_A_LIST);
+    }
+
+    case Token::CLOSE_PAREN:
+      // Only an unmatched one can be met, the others end the sequence.
+      return util::Result<LazyNode>(Parser::TOKENIZER_EXCEPTION,
+                                    "Unrecognizable token.");
+
+    default:
+      return LazyNode(_document, token.offset, token.offset + token.length,
+                      LazyNode::NOT_A_LIST);
+  }
+}
+
+util::Result<LazyDocument> LazyDocument::FromBuffer(
+    const char *data, size_t size, std::shared_ptr<const void> owner) {
+  std::vector<ListSpan> lists;
+  // The indices of the lists being closed, innermost last.
+  std::vector<size_t> open_lists;
+  StructureScanner scanner;
+
+  for (size_t position = 0; position < size; ++position) {
+    size_t depth = scanner.depth();
+    scanner.Feed(data[position]);
+    if (scanner.depth() > depth) {
+      open_lists.push_back(lists.size());
+      lists.push_back(ListSpan{position, 0, 0});
+    } else if (scanner.depth() < depth) {
+      ListSpan &list = lists[open_lists.back()];
+      list.close = position;
+      list.next = lists.size();
+      open_lists.pop_back();
+    }
+  }
+
+  if (!open_lists.empty()) {
+    return util::Result<LazyDocument>(Parser::UNMATCHED_PAREN);
+  }
+
+  return LazyDocument(data, size, std::move(owner), std::move(lists));
+}
+
+util::Result<LazyDocument> LazyDocument::FromMappedFile(
+    const std::string &path) {
+  auto mapped = util::MappedFile::Open(path);
+  if (!mapped.ok()) {
+    return util::Result<LazyDocument>(
+        Parser::IO_ERROR, std::string(mapped.error_message()));
+  }
+
+  std::shared_ptr<const util::MappedFile> file = mapped.value();
+  return FromBuffer(file->data(), file->size(), file);
+}
+
+LazyCursor LazyDocument::forms() const {
+  return LazyCursor(this, 0, _size, 0);
+}
+
+}  // namespace lisparser
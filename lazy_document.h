@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "buffer_tokenizer.h"
+#include "util/arena.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+class LazyCursor;
+class LazyDocument;
+
+// A form of a LazyDocument that has not been parsed yet. It is a view
+// into the document, which has to outlive it.
+class LazyNode {
+ public:
+  inline bool is_list() const {
+    return _list != NOT_A_LIST;
+  }
+
+  // The code of the form.
+  inline std::string_view source() const;
+
+  // Iterates through the children of a list, and through nothing for
+  // an atom.
+  LazyCursor children() const;
+
+  // Returns the child of a list at the given index, or EMPTY if there
+  // are not that many. Only the children before it are tokenized.
+  util::Result<LazyNode> Child(size_t index) const;
+
+  // Parses the whole form into an AST, allocated in the arena if any.
+  util::Result<AST> Materialize(util::Arena *arena = nullptr) const;
+
+ private:
+  friend class LazyCursor;
+
+  static constexpr size_t NOT_A_LIST = std::numeric_limits<size_t>::max();
+
+  LazyNode(const LazyDocument *document, size_t begin, size_t end,
+           size_t list)
+      : _document(document), _begin(begin), _end(end), _list(list) {}
+
+  const LazyDocument *_document;
+  // The offsets of the form in the document.
+  size_t _begin;
+  size_t _end;
+  // The index of the list in the structural index.
+  size_t _list;
+};
+
+// Goes through a sequence of forms, tokenizing only the atoms among
+// them. The lists are skipped in constant time using the structural
+// index, so whatever is inside them is never looked at.
+class LazyCursor {
+ public:
+  // Returns the next form, or EMPTY after the last one.
+  util::Result<LazyNode> Next();
+
+ private:
+  friend class LazyDocument;
+  friend class LazyNode;
+
+  LazyCursor(const LazyDocument *document, size_t begin, size_t end,
+             size_t next_list);
+
+  LazyCursor(const LazyCursor&) = delete;
+  const LazyCursor &operator=(const LazyCursor&) = delete;
+
+  const LazyDocument *_document;
+  // Ends where the sequence ends.
+  BufferTokenizer _tokenizer;
+  // The index of the next list to be met.
+  size_t _next_list;
+};
+
+// LazyDocument parses a buffer on demand. Building it only takes one
+// pass over the buffer to find the matching parens (skipping strings
+// and comments), and the forms are tokenized and turned into ASTs as
+// they are accessed, so that reading a few forms of a huge document is
+// cheap.
+//
+// Errors inside a form are only reported when the form is accessed,
+// except for unclosed lists, which the index needs to know about.
+// The document must not be moved while nodes or cursors refer to it.
+class LazyDocument {
+ public:
+  // The buffer is not copied. It has to outlive the document, unless
+  // the owner keeps it alive.
+  static util::Result<LazyDocument> FromBuffer(
+      const char *data, size_t size,
+      std::shared_ptr<const void> owner = nullptr);
+
+  static util::Result<LazyDocument> FromMappedFile(const std::string &path);
+
+  LazyDocument(LazyDocument &&other) = default;
+
+  // Iterates through the top-level forms.
+  LazyCursor forms() const;
+
+  inline const char *data() const {
+    return _data;
+  }
+
+  inline size_t size() const {
+    return _size;
+  }
+
+ private:
+  friend class LazyCursor;
+  friend class LazyNode;
+
+  // A list, from its opening paren to its closing one.
+  struct ListSpan {
+    size_t open;
+    size_t close;
+    // The index of the first list after this one and all the lists in
+    // it, the lists being indexed in the order of their opening parens.
+    size_t next;
+  };
+
+  LazyDocument(const char *data, size_t size,
+               std::shared_ptr<const void> owner,
+               std::vector<ListSpan> &&lists)
+      : _data(data), _size(size), _owner(std::move(owner)),
+        _lists(std::move(lists)) {}
+
+  LazyDocument(const LazyDocument&) = delete;
+  const LazyDocument &operator=(const LazyDocument&) = delete;
+
+  const char *_data;
+  size_t _size;
+  std::shared_ptr<const void> _owner;
+  std::vector<ListSpan> _lists;
+};
+
+inline std::string_view LazyNode::source() const {
+  return std::string_view(_document->data() + _begin, _end - _begin);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,143 @@
+#include "lazy_document.h"
+
+#include <string>
+#include "gtest/gtest.h"
+#include "parser.h"
+
+namespace lisparser {
+
+namespace {
+LazyDocument MakeDocument(const std::string &code) {
+  auto document = LazyDocument::FromBuffer(code.data(), code.size());
+  EXPECT_TRUE(document.ok());
+  return std::move(document).value();
+}
+}  // namespace
+
+TEST(LazyDocument, FormsTest) {
+  std::string code = "(defun f (x) \"a ) (\") ; (\n atom ,eval 12 :key";
+  LazyDocument document = MakeDocument(code);
+  LazyCursor forms = document.forms();
+
+  auto first = forms.Next();
+  ASSERT_TRUE(first.ok());
+  EXPECT_TRUE(first.value().is_list());
+  EXPECT_EQ("(defun f (x) \"a ) (\")", first.value().source());
+
+  std::vector<std::string> atoms;
+  for (auto form = forms.Next(); form.ok(); form = forms.Next()) {
+    EXPECT_FALSE(form.value().is_list());
+    atoms.emplace_back(form.value().source());
+  }
+  EXPECT_EQ(std::vector<std::string>({"atom", ",eval", "12", ":key"}),
+            atoms);
+}
+
+TEST(LazyDocument, ChildrenTest) {
+  std::string code = "(a (b (c d) \"e\") (f) g)";
+  LazyDocument document = MakeDocument(code);
+  auto root = document.forms().Next();
+  ASSERT_TRUE(root.ok());
+
+  std::vector<std::string> children;
+  LazyCursor cursor = root.value().children();
+  for (auto child = cursor.Next(); child.ok(); child = cursor.Next()) {
+    children.emplace_back(child.value().source());
+  }
+  EXPECT_EQ(std::vector<std::string>({"a", "(b (c d) \"e\")", "(f)", "g"}),
+            children);
+
+  auto deep = root.value().Child(1);
+  ASSERT_TRUE(deep.ok());
+  deep = deep.value().Child(1);
+  ASSERT_TRUE(deep.ok());
+  deep = deep.value().Child(1);
+  ASSERT_TRUE(deep.ok());
+  EXPECT_EQ("d", deep.value().source());
+
+  EXPECT_EQ(Parser::EMPTY, root.value().Child(4).error_code());
+  EXPECT_EQ(Parser::EMPTY, deep.value().Child(0).error_code());
+}
+
+TEST(LazyDocument, MaterializeTest) {
+  std::string code = "(Defun f (x) ,y -1.5) :key";
+  LazyDocument document = MakeDocument(code);
+  LazyCursor forms = document.forms();
+
+  auto first = forms.Next();
+  ASSERT_TRUE(first.ok());
+  auto ast = first.value().Materialize();
+  ASSERT_TRUE(ast.ok());
+  EXPECT_EQ(AST::Vector(AST::Symbol("defun"), AST::Symbol("f"),
+                        AST::Vector(AST::Symbol("x")), AST::EvalForm("y"),
+                        AST::Double(-1.5)),
+            ast.value());
+
+  util::Arena arena;
+  auto child = first.value().Child(2);
+  ASSERT_TRUE(child.ok());
+  ast = child.value().Materialize(&arena);
+  ASSERT_TRUE(ast.ok());
+  EXPECT_EQ(AST::Vector(AST::Symbol("x")), ast.value());
+
+  auto second = forms.Next();
+  ASSERT_TRUE(second.ok());
+  ast = second.value().Materialize();
+  ASSERT_TRUE(ast.ok());
+  EXPECT_EQ(AST::Keyword(":key"), ast.value());
+}
+
+TEST(LazyDocument, SkipsUnvisitedErrorsTest) {
+  // The invalid character is never tokenized, since the list is skipped.
+  std::string code = "(a 'quoted) b ) c";
+  LazyDocument document = MakeDocument(code);
+  LazyCursor forms = document.forms();
+
+  auto first = forms.Next();
+  ASSERT_TRUE(first.ok());
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION,
+            first.value().Materialize().error_code());
+
+  auto second = forms.Next();
+  ASSERT_TRUE(second.ok());
+  EXPECT_EQ("b", second.value().source());
+
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, forms.Next().error_code());
+}
+
+TEST(LazyDocument, ErrorTest) {
+  std::string unclosed = "(a) (b (c)";
+  EXPECT_EQ(Parser::UNMATCHED_PAREN,
+            LazyDocument::FromBuffer(unclosed.data(), unclosed.size())
+            .error_code());
+
+  std::string bad_eval_form = ", (a)";
+  LazyDocument document = MakeDocument(bad_eval_form);
+  EXPECT_EQ(Parser::BAD_EVAL_FORM, document.forms().Next().error_code());
+
+  EXPECT_EQ(Parser::IO_ERROR,
+            LazyDocument::FromMappedFile("/no/such/file").error_code());
+}
+
+TEST(LazyDocument, SameAsParserTest) {
+  std::string code;
+  for (int i = 0; i < 100; ++i) {
+    code += "(defun f" + std::to_string(i) + " (x (y)) \"a ) string (\") ";
+    code += "; a comment with ( and \"\n" + std::to_string(i) + " ,z\n";
+  }
+  LazyDocument document = MakeDocument(code);
+  LazyCursor forms = document.forms();
+  Parser parser(code);
+
+  do {
+    auto expected = parser.Next();
+    auto node = forms.Next();
+    ASSERT_EQ(expected.ok(), node.ok());
+    if (!expected.ok()) break;
+    auto actual = node.value().Materialize();
+    ASSERT_TRUE(actual.ok());
+    EXPECT_EQ(expected.value(), actual.value());
+  } while (true);
+}
+
+}  // namespace lisparser
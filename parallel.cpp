@@ -0,0 +1,112 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <iterator>
+#include "buffer_tokenizer.h"
+#include "parser.h"
+#include "structure.h"
+#include "util/mapped_file.h"
+#include "util/parallel_for.h"
+
+namespace lisparser {
+
+namespace {
+// Cut the input into more chunks than threads, so that a few chunks
+// that happen to be slow do not leave the other threads idle.
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+struct ChunkResult {
+  ChunkResult() : forms(), error_code(Parser::EMPTY), error_message() {}
+
+  std::vector<AST> forms;
+  // EMPTY when all the forms of the chunk were parsed.
+  int error_code;
+  std::string error_message;
+};
+
+void ParseChunk(const char *data, size_t size, ChunkResult *result) {
+  Parser parser(new BufferTokenizer(data, size));
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) {
+      result->error_code = form.error_code();
+      result->error_message = std::string(form.error_message());
+      return;
+    }
+    result->forms.push_back(std::move(form.value()));
+  } while (true);
+}
+}  // namespace
+
+std::vector<size_t> FindSplitPoints(const char *data, size_t size,
+                                    size_t num_chunks) {
+  std::vector<size_t> points;
+  if (num_chunks <= 1) return points;
+
+  StructureScanner scanner;
+  size_t next_chunk = 1;
+  size_t target = size / num_chunks;
+
+  for (size_t position = 0; position < size; ++position) {
+    if (position >= target && position > 0 &&
+        scanner.AtTopLevelBoundary()) {
+      points.push_back(position);
+      // Skip the targets that this split point already covers.
+      while (next_chunk < num_chunks && target <= position) {
+        ++next_chunk;
+        target = size * next_chunk / num_chunks;
+      }
+      if (next_chunk == num_chunks) break;
+    }
+    scanner.Feed(data[position]);
+  }
+
+  return points;
+}
+
+util::Result<std::vector<AST>> ParseParallel(const char *data, size_t size,
+                                             size_t num_threads) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  std::vector<size_t> bounds = FindSplitPoints(
+      data, size, num_threads == 1 ? 1 : num_threads * CHUNKS_PER_THREAD);
+  bounds.insert(bounds.begin(), 0);
+  bounds.push_back(size);
+
+  std::vector<ChunkResult> results(bounds.size() - 1);
+  util::ParallelFor(results.size(), num_threads,
+                    [data, &bounds, &results](size_t i) {
+                      ParseChunk(data + bounds[i], bounds[i + 1] - bounds[i],
+                                 &results[i]);
+                    });
+
+  size_t num_forms = 0;
+  for (const ChunkResult &result : results) {
+    if (result.error_code != Parser::EMPTY) {
+      return util::Result<std::vector<AST>>(
+          result.error_code, std::string(result.error_message));
+    }
+    num_forms += result.forms.size();
+  }
+
+  std::vector<AST> forms;
+  forms.reserve(num_forms);
+  for (ChunkResult &result : results) {
+    std::move(result.forms.begin(), result.forms.end(),
+              std::back_inserter(forms));
+  }
+  return forms;
+}
+
+util::Result<std::vector<AST>> ParseFileParallel(const std::string &path,
+                                                 size_t num_threads) {
+  auto mapped = util::MappedFile::Open(path);
+  if (!mapped.ok()) {
+    return util::Result<std::vector<AST>>(
+        Parser::IO_ERROR, std::string(mapped.error_message()));
+  }
+
+  const util::MappedFile &file = *mapped.value();
+  return ParseParallel(file.data(), file.size(), num_threads);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+// Returns up to (num_chunks - 1) increasing positions in the buffer at
+// which it can be cut into pieces that parse to the same top-level
+// forms as the whole. They are chosen at top-level form boundaries close
+// to evenly spaced targets, by a single pass that tracks the paren depth
+// and skips strings and comments.
+std::vector<size_t> FindSplitPoints(const char *data, size_t size,
+                                    size_t num_chunks);
+
+// Parses all the top-level forms in the buffer, splitting it into
+// chunks that are parsed concurrently by num_threads threads. The forms
+// are returned in source order. If any form fails to parse, the error
+// of the first failing one is returned instead.
+util::Result<std::vector<AST>> ParseParallel(const char *data, size_t size,
+                                             size_t num_threads);
+
+// Same as above, for a file that is mapped into memory.
+util::Result<std::vector<AST>> ParseFileParallel(const std::string &path,
+                                                 size_t num_threads);
+
+}  // namespace lisparser
@@ -0,0 +1,76 @@
+#include "parallel.h"
+
+#include <string>
+#include "gtest/gtest.h"
+#include "parser.h"
+
+namespace lisparser {
+
+namespace {
+// Forms with parens hidden in strings, comments and escapes, symbols
+// containing ';' and top-level eval forms, which all have to be kept
+// in one piece.
+std::string MakeCode(int num_repeats) {
+  std::string code;
+  for (int i = 0; i < num_repeats; ++i) {
+    code += "(defun f" + std::to_string(i) + " (x) \"a ) string (\" x) ";
+    code += "; a comment with ( and \"\n";
+    code += "(a \"escaped \\\" ) \\\\\" b) atom;with;semicolons ";
+    code += ", ;comment between comma and symbol\n evaluated ";
+    code += std::to_string(i) + " -1.5 \"top ( level\" :key\n";
+  }
+  return code;
+}
+
+std::vector<AST> ParseSerially(const std::string &code) {
+  std::vector<AST> forms;
+  Parser parser(code);
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) {
+      EXPECT_EQ(Parser::EMPTY, form.error_code());
+      return forms;
+    }
+    forms.push_back(std::move(form.value()));
+  } while (true);
+}
+}  // namespace
+
+TEST(Parallel, FindSplitPointsTest) {
+  std::string code = "(a \"(\" b) ; (\nabc , def (x (y))";
+  std::vector<size_t> points = FindSplitPoints(code.data(), code.size(),
+                                               code.size());
+  // Between the top-level forms only, never after the comma.
+  EXPECT_EQ(std::vector<size_t>({9, 10, 14, 18, 24}), points);
+
+  EXPECT_TRUE(FindSplitPoints(code.data(), code.size(), 1).empty());
+}
+
+TEST(Parallel, SameAsSerialTest) {
+  std::string code = MakeCode(200);
+  std::vector<AST> expected = ParseSerially(code);
+  ASSERT_EQ(1600, expected.size());
+
+  for (size_t num_threads : {1, 2, 3, 8}) {
+    auto result = ParseParallel(code.data(), code.size(), num_threads);
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(expected, result.value());
+  }
+}
+
+TEST(Parallel, ErrorTest) {
+  std::string code = MakeCode(100) + " (unclosed " + MakeCode(100) +
+      " (:bad . ) " + MakeCode(100);
+
+  auto result = ParseParallel(code.data(), code.size(), 4);
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, result.error_code());
+}
+
+TEST(Parallel, EmptyTest) {
+  auto result = ParseParallel("", 0, 4);
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result.value().empty());
+}
+
+}  // namespace lisparser
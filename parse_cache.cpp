@@ -0,0 +1,119 @@
+#include "parse_cache.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+#include <unistd.h>
+#include "binary.h"
+#include "parser.h"
+#include "util/hash.h"
+#include "util/mapped_file.h"
+
+namespace lisparser {
+
+namespace {
+constexpr size_t DIGEST_SIZE = 16;
+
+std::string Digest(const char *code, size_t size) {
+  std::array<uint64_t, 2> hash = util::Hash128(code, size);
+  std::string digest(DIGEST_SIZE, '\0');
+  for (size_t i = 0; i < DIGEST_SIZE; ++i) {
+    digest[i] = static_cast<char>(hash[i / 8] >> (8 * (i % 8)));
+  }
+  return digest;
+}
+
+// Distinguishes the temporary files of the threads of one process.
+std::atomic<uint64_t> next_temporary_id(0);
+}  // namespace
+
+util::Result<std::vector<AST>> ParseCache::Load(const char *code,
+                                                size_t size) const {
+  using FormsResult = util::Result<std::vector<AST>>;
+
+  auto entry = OpenEntry(code, size);
+  if (!entry.ok()) return FormsResult::ErrorFrom(std::move(entry));
+
+  const util::MappedFile &file = *entry.value();
+  auto forms = DecodeBinary(file.data() + DIGEST_SIZE,
+                            file.size() - DIGEST_SIZE,
+                            Parser::DEFAULT_MAX_DEPTH);
+  if (!forms.ok()) {
+    return FormsResult(BAD_ENTRY, std::string(forms.error_message()));
+  }
+  return forms;
+}
+
+util::Result<CachedForms> ParseCache::LoadView(const char *code,
+                                               size_t size) const {
+  using ViewResult = util::Result<CachedForms>;
+
+  auto entry = OpenEntry(code, size);
+  if (!entry.ok()) return ViewResult::ErrorFrom(std::move(entry));
+
+  std::shared_ptr<const util::MappedFile> file = entry.value();
+  auto view = BinaryView::Open(file->data() + DIGEST_SIZE,
+                               file->size() - DIGEST_SIZE,
+                               Parser::DEFAULT_MAX_DEPTH);
+  if (!view.ok()) {
+    return ViewResult(BAD_ENTRY, std::string(view.error_message()));
+  }
+  return CachedForms(std::move(file), std::move(view).value());
+}
+
+util::Result<std::shared_ptr<const util::MappedFile>> ParseCache::OpenEntry(
+    const char *code, size_t size) const {
+  using EntryResult = util::Result<std::shared_ptr<const util::MappedFile>>;
+
+  auto mapped = util::MappedFile::Open(PathFor(code, size));
+  if (!mapped.ok()) return EntryResult(MISS);
+
+  const util::MappedFile &file = *mapped.value();
+  if (file.size() < DIGEST_SIZE) {
+    return EntryResult(BAD_ENTRY, "entry without a digest");
+  }
+  if (std::string_view(file.data(), DIGEST_SIZE) != Digest(code, size)) {
+    return EntryResult(MISS);
+  }
+  return mapped;
+}
+
+bool ParseCache::Store(const char *code, size_t size,
+                       const std::vector<AST> &forms) const {
+  std::string path = PathFor(code, size);
+  std::string temporary_path = util::StrCat(
+      path, ".", static_cast<long>(getpid()), "-",
+      next_temporary_id.fetch_add(1, std::memory_order_relaxed), ".tmp");
+
+  std::ofstream output(temporary_path,
+                       std::ofstream::out | std::ofstream::binary);
+  std::string digest = Digest(code, size);
+  std::string encoding = EncodeBinary(forms);
+  output.write(digest.data(), digest.size());
+  output.write(encoding.data(), encoding.size());
+  // Closing flushes the last writes, which can fail too.
+  output.close();
+  if (output.fail()) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string ParseCache::PathFor(const char *code, size_t size) const {
+  char name[64];
+  std::snprintf(name, sizeof(name), "%016llx-%llu.v%d.lspb",
+                static_cast<unsigned long long>(util::Hash64(code, size)),
+                static_cast<unsigned long long>(size),
+                static_cast<int>(BINARY_VERSION));
+  return util::StrCat(_directory, "/", name);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "binary.h"
+#include "util/mapped_file.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+// The forms of a cache entry, read in place from the mapping of the
+// entry, which it keeps alive. It must not be moved while nodes or
+// cursors of its view refer to it.
+class CachedForms {
+ public:
+  CachedForms(CachedForms &&other) = default;
+
+  inline const BinaryView &view() const {
+    return _view;
+  }
+
+ private:
+  friend class ParseCache;
+
+  CachedForms(std::shared_ptr<const util::MappedFile> &&file,
+              BinaryView &&view)
+      : _file(std::move(file)), _view(std::move(view)) {}
+
+  std::shared_ptr<const util::MappedFile> _file;
+  BinaryView _view;
+};
+
+// ParseCache keeps the binary encoding (see binary.h) of the forms
+// parsed from some code in a directory, keyed by the hash and the size
+// of the code, so that the code does not have to be parsed again as
+// long as it does not change. Several processes can share one
+// directory.
+//
+// Each entry starts with a 128-bit digest of the code (see
+// util::Hash128), which is independent of the key and checked on
+// loading, so that two pieces of code whose keys collide do not get
+// each other's forms.
+class ParseCache {
+ public:
+  enum ParseCacheError {
+    MISS = 1,
+    // The cached encoding cannot be decoded.
+    BAD_ENTRY = 2,
+  };
+
+  // The directory has to exist.
+  explicit ParseCache(const std::string &directory)
+      : _directory(directory) {}
+
+  // Returns the forms parsed from the code, if they are in the cache.
+  // An entry stored for other code with the same key is a MISS. The
+  // forms are decoded into ASTs, with their names interned, because
+  // that is what a Parser hands out. LoadView() avoids that when the
+  // forms are only read.
+  util::Result<std::vector<AST>> Load(const char *code, size_t size) const;
+
+  // Same as above, but reads the forms in place from the mapped entry,
+  // so that nothing is decoded until it is accessed.
+  util::Result<CachedForms> LoadView(const char *code, size_t size) const;
+
+  // Stores the forms parsed from the code, and returns whether it
+  // succeeded. The entry is written to a temporary file with a name no
+  // other writer uses first, so that readers never see a partial one.
+  bool Store(const char *code, size_t size,
+             const std::vector<AST> &forms) const;
+
+  // The path of the entry for the code.
+  std::string PathFor(const char *code, size_t size) const;
+
+ private:
+  // Maps the entry for the code, and checks that it was stored for it.
+  util::Result<std::shared_ptr<const util::MappedFile>> OpenEntry(
+      const char *code, size_t size) const;
+
+  std::string _directory;
+};
+
+}  // namespace lisparser
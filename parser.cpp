@@ -1,95 +1,90 @@
 #include "parser.h"
 
 #include <fstream>
+#include "parse_cache.h"
+#include "util/mapped_file.h"
 
 namespace lisparser {
 
-Parser Parser::FromFile(const std::string &path) {
-  return Parser(new Tokenizer(
-      new std::ifstream(path, std::ifstream::in)));
+Parser::Parser(const std::string &code)
+    : _events(), _buffer_events(), _builder(), _forms(), _next_form(0) {
+  auto buffer = std::make_shared<const std::string>(code);
+  _buffer_events.reset(new EventParser<BufferTokenizer>(
+      new BufferTokenizer(buffer->data(), buffer->size(), buffer)));
 }
 
-util::Result<AST> Parser::Next() {
-
-  if (_closed) return util::Result<AST>(Parser::EMPTY);
-
-  Token token = _tokenizer->Next();
-
-  if (token.type == Token::TERMINATOR) {
-    _closed = true;
-    return util::Result<AST>(Parser::EMPTY);
+Parser Parser::FromFile(const std::string &path, const ParseCache *cache) {
+  if (cache != nullptr) {
+    auto mapped = util::MappedFile::Open(path);
+    if (mapped.ok()) return FromCache(mapped.value(), *cache);
   }
 
-  return ConsumeToken(std::move(token));
+  return Parser(new Tokenizer(
+      new std::ifstream(path, std::ifstream::in)));
 }
 
-util::Result<AST> Parser::ConsumeToken(Token &&start) {
-  switch (start.type) {
-    case Token::TERMINATOR:
-      _closed = true;
-      return util::Result<AST>(Parser::EMPTY);
-
-    case Token::INVALID_TOKEN:
-      _closed = true;
-      return util::Result<AST>(Parser::TOKENIZER_EXCEPTION,
-                               std::move(start.value));
-
-    case Token::KEYWORD:
-      return AST::Keyword(std::move(start.value));
-
-    case Token::SYMBOL:
-      return AST::Symbol(std::move(start.value));
-
-    case Token::STRING:
-      return AST::String(std::move(start.value));
-
-    case Token::COMMA: {
-      Token token = _tokenizer->Next();
-
-      if (token.type != Token::SYMBOL) {
-        return util::Result<AST>(Parser::BAD_EVAL_FORM);
+Parser Parser::FromCache(std::shared_ptr<const util::MappedFile> file,
+                         const ParseCache &cache) {
+  auto cached = cache.Load(file->data(), file->size());
+  if (cached.ok()) return Parser(std::move(cached).value());
+
+  std::vector<AST> forms;
+  Parser parser(new BufferTokenizer(file->data(), file->size(), file));
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) {
+      if (form.error_code() != EMPTY) {
+        // Leave the errors to be reported in order by a parser that
+        // starts over.
+        return Parser(new BufferTokenizer(file->data(), file->size(), file));
       }
-      
-      return AST::EvalForm(std::move(token.value));
+      break;
     }
+    forms.push_back(std::move(form).value());
+  } while (true);
 
-    case Token::FLOAT: 
-      return AST::Double(std::stod(start.value));
-
-    case Token::INTEGER:
-      return AST::Integer(std::stoll(start.value));
-
-    case Token::OPEN_PAREN: {
-      AST ast = AST::Vector();
+  cache.Store(file->data(), file->size(), forms);
+  return Parser(std::move(forms));
+}
 
-      do {
-        Token token = _tokenizer->Next();
-        if (token.type == Token::CLOSE_PAREN) {
-          return std::move(ast);
-        }
+util::Result<Parser> Parser::FromMappedFile(const std::string &path) {
+  auto mapped = util::MappedFile::Open(path);
+  if (!mapped.ok()) {
+    return util::Result<Parser>(
+        Parser::IO_ERROR, std::string(mapped.error_message()));
+  }
 
-        auto result = ConsumeToken(std::move(token));
+  std::shared_ptr<const util::MappedFile> file = mapped.value();
+  return Parser(new BufferTokenizer(file->data(), file->size(), file));
+}
 
-        if (!result.ok()) {
-          if (result.error_code() == Parser::EMPTY) {
-            return util::Result<AST>(Parser::UNMATCHED_PAREN);
-          }
-          return result;
-        }
+util::Result<AST> Parser::Next() {
+  if (!_events && !_buffer_events) {
+    if (_next_form == _forms.size()) return util::Result<AST>(EMPTY);
+    return std::move(_forms[_next_form++]);
+  }
 
-        ast.Push(std::move(*result.value()));
-      } while(true);
+  _builder.Reset();
+  util::Result<size_t> form = _buffer_events ?
+      _buffer_events->Next(&_builder) : _events->Next(&_builder);
+  if (!form.ok()) {
+    return util::Result<AST>::ErrorFrom(std::move(form));
+  }
+  return _builder.Release();
+}
 
-      return util::Result<AST>(Parser::TOKENIZER_EXCEPTION,
-                               "Unreachable.");
-    }
-      
-    default:
-      // TODO(breakds): Append the stringified token to the end of the
-      // error message.
-      return util::Result<AST>(Parser::TOKENIZER_EXCEPTION,
-                               "Unrecognizable token.");
+void Parser::set_max_depth(size_t max_depth) {
+  if (_buffer_events) {
+    _buffer_events->set_max_depth(max_depth);
+  } else if (_events) {
+    _events->set_max_depth(max_depth);
   }
 }
 
+const ParserStats *Parser::stats() const {
+  if (_buffer_events) return _buffer_events->stats();
+  if (_events) return _events->stats();
+  return nullptr;
+}
+
 }  // namespace lisparser
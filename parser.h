@@ -1,44 +1,166 @@
 #pragma once
 
 #include <memory>
+#include <string_view>
+#include <vector>
 #include "ast.h"
+#include "buffer_tokenizer.h"
+#include "event_parser.h"
+#include "symbol.h"
 #include "tokenizer.h"
+#include "util/arena.h"
 #include "util/result.h"
 
 namespace lisparser {
 
-class Parser {
+class ParseCache;
+
+namespace util {
+class MappedFile;
+}  // namespace util
+
+// Handler of EventParser that builds the AST of every form.
+class AstBuilder {
  public:
-  enum ParserError {
-    EMPTY = 1,
-    TOKENIZER_EXCEPTION = 2,
-    BAD_EVAL_FORM = 3,
-    UNMATCHED_PAREN = 4,
-  };
+  AstBuilder()
+      : _resource(std::pmr::get_default_resource()), _symbols(), _stack(),
+        _result(AST::Integer(0)) {}
+
+  inline void OnListBegin() {
+    _stack.push_back(AST::Vector(_resource));
+  }
+
+  inline void OnListEnd() {
+    AST list = std::move(_stack.back());
+    _stack.pop_back();
+    Add(std::move(list));
+  }
+
+  inline void OnSymbol(std::string_view name) {
+    Add(AST::Symbol(_symbols.Intern(name)));
+  }
+
+  inline void OnKeyword(std::string_view name) {
+    Add(AST::Keyword(_symbols.Intern(name)));
+  }
+
+  inline void OnEvalForm(std::string_view name) {
+    Add(AST::EvalForm(_symbols.Intern(name)));
+  }
+
+  inline void OnString(std::string_view value) {
+    Add(AST::String(value, _resource));
+  }
+
+  inline void OnInteger(int64_t value) {
+    Add(AST::Integer(value));
+  }
+
+  inline void OnDouble(double value) {
+    Add(AST::Double(value));
+  }
+
+  // Drops the lists left unfinished by an invalid form.
+  inline void Reset() {
+    _stack.clear();
+  }
+
+  // The AST of the last complete form.
+  inline AST Release() {
+    return std::move(_result);
+  }
+
+  inline void set_resource(std::pmr::memory_resource *resource) {
+    _resource = resource;
+  }
 
+ private:
+  inline void Add(AST &&node) {
+    if (_stack.empty()) {
+      _result = std::move(node);
+    } else {
+      _stack.back().Push(std::move(node));
+    }
+  }
+
+  std::pmr::memory_resource *_resource;
+  // Interns the symbols, keywords and eval forms.
+  SymbolCache _symbols;
+  // The lists being built, innermost last.
+  std::vector<AST> _stack;
+  AST _result;
+};
+
+// Parser builds the AST of every top-level form, as a client of
+// EventParser.
+class Parser : public ParserBase {
+ public:
   Parser(Tokenizer *tokenizer)
-      : _tokenizer(tokenizer), _closed(false) {}
+      : _events(new EventParser<Tokenizer>(tokenizer)), _buffer_events(),
+        _builder(), _forms(), _next_form(0) {}
+
+  Parser(BufferTokenizer *tokenizer)
+      : _events(), _buffer_events(new EventParser<BufferTokenizer>(tokenizer)),
+        _builder(), _forms(), _next_form(0) {}
 
-  Parser(const std::string &code)
-      : Parser(new Tokenizer(code)) {}
+  // The code is copied into a buffer owned by the parser.
+  Parser(const std::string &code);
 
   Parser(Parser &&other) 
-      : _tokenizer(std::move(other._tokenizer)),
-        _closed(other._closed) {}
+      : _events(std::move(other._events)),
+        _buffer_events(std::move(other._buffer_events)),
+        _builder(std::move(other._builder)),
+        _forms(std::move(other._forms)), _next_form(other._next_form) {}
+
+  // With a cache, the file is mapped and its forms are loaded from the
+  // cache if it has them. Otherwise they are parsed at once and stored
+  // into the cache, unless the file has errors. Either way, the forms
+  // are then returned from memory, and set_arena() and set_max_depth()
+  // no longer apply to them.
+  static Parser FromFile(const std::string &path,
+                         const ParseCache *cache = nullptr);
 
-  static Parser FromFile(const std::string &path);
+  // Maps the file read-only instead of reading it through a stream. The
+  // mapping lives as long as the parser, and the ASTs produced own
+  // their content, so they can outlive both.
+  static util::Result<Parser> FromMappedFile(const std::string &path);
 
   util::Result<AST> Next();
 
+  // Allocates all the ASTs produced from now on (nodes, strings and
+  // lists of children) in the arena, which is not owned by the parser
+  // and has to outlive those ASTs.
+  inline void set_arena(util::Arena *arena) {
+    _builder.set_resource(arena);
+  }
+
+  void set_max_depth(size_t max_depth);
+
+  // What the parser has done so far, see ParserStats. Returns nullptr
+  // unless STATS_ENABLED, and for forms loaded from a cache.
+  const ParserStats *stats() const;
+
  private:
   Parser(const Parser&) = delete;
   const Parser &operator=(const Parser&) = delete;
   const Parser &operator=(Parser&&) = delete;
-  
-  util::Result<AST> ConsumeToken(Token &&start);
-  
-  std::unique_ptr<Tokenizer> _tokenizer;
-  bool _closed;
+
+  // Loads the forms of the file from the cache, or parses them.
+  static Parser FromCache(std::shared_ptr<const util::MappedFile> file,
+                          const ParseCache &cache);
+
+  // Returns the forms one by one.
+  explicit Parser(std::vector<AST> &&forms)
+      : _events(), _buffer_events(), _builder(),
+        _forms(std::move(forms)), _next_form(0) {}
+
+  // At most one of the two is set. When none is, the forms come from
+  // _forms.
+  std::unique_ptr<EventParser<Tokenizer>> _events;
+  std::unique_ptr<EventParser<BufferTokenizer>> _buffer_events;
+  AstBuilder _builder;
+  std::vector<AST> _forms;
+  size_t _next_form;
 };
 
 }  // namespace lisparser
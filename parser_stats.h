@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace lisparser {
+
+// Statistics are only collected when the library is built with
+// LISPARSER_STATS defined, e.g. by the LISPARSER_ENABLE_STATS option of
+// CMake. Otherwise the code that collects them is compiled out, and the
+// parsers return nullptr as their stats().
+#ifdef LISPARSER_STATS
+constexpr bool STATS_ENABLED = true;
+#else
+constexpr bool STATS_ENABLED = false;
+#endif
+
+// StatCounter is updated by a single thread, and can be read by any
+// thread at any time. Updates are a relaxed load and store instead of an
+// atomic read-modify-write, which would be much slower.
+class StatCounter {
+ public:
+  StatCounter() : _value(0) {}
+
+  inline void Add(uint64_t amount) {
+    Set(value() + amount);
+  }
+
+  inline void Max(uint64_t candidate) {
+    if (candidate > value()) Set(candidate);
+  }
+
+  inline void Set(uint64_t new_value) {
+    _value.store(new_value, std::memory_order_relaxed);
+  }
+
+  inline uint64_t value() const {
+    return _value.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> _value;
+};
+
+// ParserStats describes the work a parser has done since it was created.
+// The counters are independent, so a reader running concurrently with
+// the parser may see some of them one form ahead of the others.
+struct ParserStats {
+  // The valid tokens, from Token::OPEN_PAREN to Token::INTEGER.
+  static constexpr size_t NUM_TOKEN_TYPES = 8;
+  // Indexed by ParserBase::ParserError, so that 0 is unused.
+  static constexpr size_t NUM_ERROR_CODES = 8;
+  static constexpr size_t NUM_LATENCY_BUCKETS = 40;
+
+  // Latencies of n nanoseconds fall into the bucket of the bit width of
+  // n, i.e. bucket i > 0 is [2^(i-1), 2^i) nanoseconds, and the last
+  // bucket takes all the larger ones.
+  static inline size_t LatencyBucket(uint64_t nanoseconds) {
+    size_t bucket = 0;
+    while (nanoseconds > 0 && bucket + 1 < NUM_LATENCY_BUCKETS) {
+      nanoseconds >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  // Tokens read, by Token::Type.
+  std::array<StatCounter, NUM_TOKEN_TYPES> tokens;
+  // Top-level forms parsed successfully, and their atoms and lists.
+  StatCounter forms;
+  StatCounter nodes;
+  // Input consumed, as far as the tokenizer can tell.
+  StatCounter bytes;
+  // The deepest nesting of lists seen.
+  StatCounter max_depth;
+  // Time spent in the parser in total, and in the tokenizer alone. The
+  // difference is spent building the forms.
+  StatCounter total_nanoseconds;
+  StatCounter tokenize_nanoseconds;
+  // Calls that failed, by error code. errors[EMPTY] counts the times the
+  // end of the input was reached.
+  std::array<StatCounter, NUM_ERROR_CODES> errors;
+  // The time taken by every call, successful or not, see LatencyBucket().
+  std::array<StatCounter, NUM_LATENCY_BUCKETS> latency;
+};
+
+}  // namespace lisparser
@@ -1,50 +1,82 @@
 #include "parser.h"
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
 #include "gtest/gtest.h"
+#include "parse_cache.h"
 
 namespace lisparser {
 
 TEST(Parser, KeywordTest) {
   Parser parser(":abc");
-  EXPECT_EQ(AST::Keyword(":abc"), *parser.Next().value());
+  EXPECT_EQ(AST::Keyword(":abc"), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
 TEST(Parser, SymbolTest) {
   Parser parser("AbC");
-  EXPECT_EQ(AST::Symbol("abc"), *parser.Next().value());
+  EXPECT_EQ(AST::Symbol("abc"), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
 TEST(Parser, StringTest) {
   Parser parser("\"AbC\"");
-  EXPECT_EQ(AST::String("AbC"), *parser.Next().value());
+  EXPECT_EQ(AST::String("AbC"), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
 TEST(Parser, EvalFormTest) {
   Parser parser(",VAR");
-  EXPECT_EQ(AST::EvalForm("var"), *parser.Next().value());
+  EXPECT_EQ(AST::EvalForm("var"), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
 TEST(Parser, IntegerTest) {
   Parser parser("123");
-  EXPECT_EQ(AST::Integer(123), *parser.Next().value());
+  EXPECT_EQ(AST::Integer(123), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
 TEST(Parser, DoubleTest) {
   Parser parser("123.567");
-  EXPECT_EQ(AST::Double(123.567), *parser.Next().value());
+  EXPECT_EQ(AST::Double(123.567), parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
+TEST(Parser, NumberOutOfRangeTest) {
+  {
+    Parser parser("(1 2 92233720368547758070)");
+    auto result = parser.Next();
+    EXPECT_EQ(Parser::OUT_OF_RANGE, result.error_code());
+    EXPECT_EQ("Number out of range: 92233720368547758070",
+              result.error_message());
+    EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+  }
+  {
+    Parser parser(new Tokenizer(std::string(400, '1') + ".0"));
+    EXPECT_EQ(Parser::OUT_OF_RANGE, parser.Next().error_code());
+  }
+  // Malformed numbers are invalid tokens, whichever the tokenizer.
+  {
+    Parser parser("(1 -.)");
+    auto result = parser.Next();
+    EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, result.error_code());
+    EXPECT_EQ("Malformed number.", result.error_message());
+  }
+  {
+    Parser parser(new Tokenizer("(1 -.)"));
+    EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, parser.Next().error_code());
+  }
+}
+
 TEST(Parser, ListTest) {
   Parser parser("(abc 123)");
 
   EXPECT_EQ(AST::Vector(AST::Symbol("abc"), AST::Integer(123)),
-            *parser.Next().value());
+            parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
@@ -52,7 +84,7 @@ TEST(Parser, EmptyListTest) {
   {
     Parser parser("()");
 
-    EXPECT_EQ(AST::Vector(), *parser.Next().value());
+    EXPECT_EQ(AST::Vector(), parser.Next().value());
     EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
   }
 
@@ -60,7 +92,7 @@ TEST(Parser, EmptyListTest) {
     Parser parser("(()())");
 
     EXPECT_EQ(AST::Vector(AST::Vector(), AST::Vector()),
-              *parser.Next().value());
+              parser.Next().value());
     EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
   }
 }
@@ -98,7 +130,7 @@ TEST(Parser, CompositeTest) {
                 ",get (:+ 1 -.5))");
   
   EXPECT_EQ(AST::Vector(AST::Symbol("hello"), AST::String("World!")),
-            *parser.Next().value());
+            parser.Next().value());
 
   EXPECT_EQ(AST::Vector(AST::Symbol("this"),
                         AST::Symbol("is"),
@@ -112,8 +144,243 @@ TEST(Parser, CompositeTest) {
                         AST::Vector(AST::Keyword(":+"),
                                     AST::Integer(1),
                                     AST::Double(-0.5))),
-            *parser.Next().value());
+            parser.Next().value());
   EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
 }
 
+TEST(Parser, StreamTokenizerTest) {
+  Parser parser(new Tokenizer(new std::istringstream(
+      "(Hello \"World!\") (:+ 1 -.5)")));
+
+  EXPECT_EQ(AST::Vector(AST::Symbol("hello"), AST::String("World!")),
+            parser.Next().value());
+  EXPECT_EQ(AST::Vector(AST::Keyword(":+"),
+                        AST::Integer(1),
+                        AST::Double(-0.5)),
+            parser.Next().value());
+  EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+}
+
+TEST(Parser, MappedFileTest) {
+  std::string path = ::testing::TempDir() + "parser_mapped_file_test.lisp";
+  {
+    std::ofstream output(path);
+    output << "(Hello \"World!\") ; comment\n(:+ 1 -.5)";
+  }
+
+  auto parser = Parser::FromMappedFile(path);
+  ASSERT_TRUE(parser.ok());
+  
+  EXPECT_EQ(AST::Vector(AST::Symbol("hello"), AST::String("World!")),
+            parser.value().Next().value());
+  std::remove(path.c_str());
+}
+
+TEST(Parser, MappedFileFailureTest) {
+  EXPECT_EQ(Parser::IO_ERROR,
+            Parser::FromMappedFile("/nonexistent/file.lisp").error_code());
+}
+
+TEST(Parser, ParseCacheTest) {
+  std::string path = ::testing::TempDir() + "parser_parse_cache_test.lisp";
+  {
+    std::ofstream output(path);
+    output << "(Hello \"World!\") :key 12";
+  }
+  ParseCache cache(::testing::TempDir());
+
+  // The first parser fills the cache, and the second one reads from it.
+  for (int i = 0; i < 2; ++i) {
+    Parser parser = Parser::FromFile(path, &cache);
+    auto result = parser.Next();
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(AST::Vector(AST::Symbol("hello"), AST::String("World!")),
+              result.value());
+    EXPECT_EQ(AST::Keyword(":key"), parser.Next().value());
+    EXPECT_EQ(AST::Integer(12), parser.Next().value());
+    EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+  }
+
+  std::string code = "(Hello \"World!\") :key 12";
+  EXPECT_TRUE(cache.Load(code.data(), code.size()).ok());
+
+  auto cached = cache.LoadView(code.data(), code.size());
+  ASSERT_TRUE(cached.ok());
+  EXPECT_EQ(3u, cached.value().view().num_forms());
+  BinaryCursor cursor = cached.value().view().forms();
+  BinaryNode form;
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(2u, form.size());
+  ASSERT_TRUE(cursor.Next(&form));
+  EXPECT_EQ(":key", form.AsString());
+
+  code = "(Hello \"World?\") :key 12";
+  EXPECT_EQ(ParseCache::MISS,
+            cache.Load(code.data(), code.size()).error_code());
+  EXPECT_EQ(ParseCache::MISS,
+            cache.LoadView(code.data(), code.size()).error_code());
+
+  std::remove(path.c_str());
+}
+
+TEST(Parser, ParseCacheErrorTest) {
+  std::string path =
+      ::testing::TempDir() + "parser_parse_cache_error_test.lisp";
+  std::string code = "a (b";
+  {
+    std::ofstream output(path);
+    output << code;
+  }
+  ParseCache cache(::testing::TempDir());
+
+  // The errors are reported as usual, and are not cached.
+  Parser parser = Parser::FromFile(path, &cache);
+  EXPECT_TRUE(parser.Next().ok());
+  EXPECT_EQ(Parser::UNMATCHED_PAREN, parser.Next().error_code());
+  EXPECT_EQ(ParseCache::MISS,
+            cache.Load(code.data(), code.size()).error_code());
+
+  std::remove(path.c_str());
+}
+
+TEST(Parser, ParseCacheCollisionTest) {
+  ParseCache cache(::testing::TempDir());
+  std::string code = "(collision a)";
+  std::string other = "(collision b)";
+  std::vector<AST> forms;
+  forms.push_back(AST::Vector(AST::Symbol("collision"), AST::Symbol("a")));
+  ASSERT_TRUE(cache.Store(code.data(), code.size(), forms));
+
+  // Pretend that the other code has the same key: the digest of the
+  // entry gives it away.
+  std::string other_path = cache.PathFor(other.data(), other.size());
+  ASSERT_EQ(0, std::rename(cache.PathFor(code.data(), code.size()).c_str(),
+                           other_path.c_str()));
+  EXPECT_EQ(ParseCache::MISS,
+            cache.Load(other.data(), other.size()).error_code());
+
+  std::ofstream(other_path, std::ofstream::binary) << "short";
+  EXPECT_EQ(ParseCache::BAD_ENTRY,
+            cache.Load(other.data(), other.size()).error_code());
+  std::remove(other_path.c_str());
+}
+
+TEST(Parser, ParseCacheConcurrentStoreTest) {
+  ParseCache cache(::testing::TempDir());
+  std::string code = "(stored (by many threads))";
+  std::vector<AST> forms;
+  forms.push_back(Parser(code).Next().value());
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 20; ++j) {
+        EXPECT_TRUE(cache.Store(code.data(), code.size(), forms));
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+
+  auto loaded = cache.Load(code.data(), code.size());
+  ASSERT_TRUE(loaded.ok());
+  EXPECT_EQ(forms, loaded.value());
+  std::remove(cache.PathFor(code.data(), code.size()).c_str());
+}
+
+TEST(Parser, MappedEmptyFileTest) {
+  std::string path = ::testing::TempDir() + "parser_mapped_empty_test.lisp";
+  std::ofstream(path).close();
+
+  auto parser = Parser::FromMappedFile(path);
+  ASSERT_TRUE(parser.ok());
+  EXPECT_EQ(Parser::EMPTY, parser.value().Next().error_code());
+  std::remove(path.c_str());
+}
+
+TEST(Parser, ArenaTest) {
+  util::Arena arena;
+  Parser parser("(this is a good (:or \"long string that does not fit\" "
+                "opportunity) to ,get (:+ 1 -.5))");
+  parser.set_arena(&arena);
+
+  // Any allocation of the ASTs that misses the arena would hit the null
+  // resource and throw.
+  std::pmr::memory_resource *default_resource =
+      std::pmr::set_default_resource(std::pmr::null_memory_resource());
+  auto result = parser.Next();
+  std::pmr::set_default_resource(default_resource);
+
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(AST::Vector(AST::Symbol("this"),
+                        AST::Symbol("is"),
+                        AST::Symbol("a"),
+                        AST::Symbol("good"),
+                        AST::Vector(AST::Keyword(":or"),
+                                    AST::String(
+                                        "long string that does not fit"),
+                                    AST::Symbol("opportunity")),
+                        AST::Symbol("to"),
+                        AST::EvalForm("get"),
+                        AST::Vector(AST::Keyword(":+"),
+                                    AST::Integer(1),
+                                    AST::Double(-0.5))),
+            result.value());
+}
+
+TEST(Parser, DeepNestingTest) {
+  const size_t depth = 5000;
+  Parser parser(std::string(depth, '(') + std::string(depth, ')') + " abc");
+
+  auto result = parser.Next();
+  ASSERT_TRUE(result.ok());
+  const AST *ast = &result.value();
+  for (size_t i = 1; i < depth; ++i) {
+    ASSERT_EQ(1, ast->AsVector().size());
+    ast = &ast->car();
+  }
+  EXPECT_EQ(AST::Vector(), *ast);
+  EXPECT_EQ(AST::Symbol("abc"), parser.Next().value());
+}
+
+TEST(Parser, MaxDepthTest) {
+  {
+    Parser parser(std::string(100000, '('));
+    auto result = parser.Next();
+    EXPECT_EQ(Parser::TOO_DEEP, result.error_code());
+    EXPECT_EQ("Nesting deeper than 10000 levels.", result.error_message());
+    EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+  }
+
+  {
+    Parser parser("(a (b (c)))");
+    parser.set_max_depth(3);
+    EXPECT_TRUE(parser.Next().ok());
+  }
+
+  {
+    Parser parser("(a (b (c)))");
+    parser.set_max_depth(2);
+    EXPECT_EQ(Parser::TOO_DEEP, parser.Next().error_code());
+  }
+}
+
+TEST(Parser, UnexpectedCloseParenTest) {
+  Parser parser(") abc");
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, parser.Next().error_code());
+  EXPECT_EQ(AST::Symbol("abc"), parser.Next().value());
+}
+
+TEST(Parser, StatsTest) {
+  Parser parser("(a (b)) (c)");
+  ASSERT_TRUE(parser.Next().ok());
+  ASSERT_TRUE(parser.Next().ok());
+  if (!STATS_ENABLED) {
+    EXPECT_EQ(nullptr, parser.stats());
+    return;
+  }
+  ASSERT_NE(nullptr, parser.stats());
+  EXPECT_EQ(2, parser.stats()->forms.value());
+  EXPECT_EQ(6, parser.stats()->nodes.value());
+}
+
 }  // namespace lisparser
@@ -0,0 +1,56 @@
+#include "push_parser.h"
+
+#include <utility>
+
+namespace lisparser {
+
+void PushParser::Feed(const char *data, size_t size) {
+  if (_finished || _failed) return;
+
+  // The end of the last complete top-level form in _pending, if any.
+  size_t complete = 0;
+  size_t offset = _pending.size();
+  _pending.append(data, size);
+  for (size_t i = 0; i < size; ++i) {
+    _scanner.Feed(data[i]);
+    if (_scanner.AtTopLevelBoundary()) complete = offset + i + 1;
+  }
+
+  if (complete > 0) ParsePending(complete);
+}
+
+void PushParser::Finish() {
+  if (_finished) return;
+  if (!_failed) ParsePending(_pending.size());
+  _finished = true;
+}
+
+util::Result<AST> PushParser::Next() {
+  if (_ready.empty()) return util::Result<AST>(Parser::EMPTY);
+
+  util::Result<AST> result = std::move(_ready.front());
+  _ready.pop_front();
+  return result;
+}
+
+void PushParser::ParsePending(size_t size) {
+  _events.Restart(_pending.data(), size);
+  do {
+    _builder.Reset();
+    util::Result<size_t> form = _events.Next(&_builder);
+    if (!form.ok()) {
+      if (form.error_code() != Parser::EMPTY) {
+        _ready.push_back(util::Result<AST>::ErrorFrom(std::move(form)));
+        _failed = true;
+        _pending.clear();
+        return;
+      }
+      break;
+    }
+    _ready.push_back(_builder.Release());
+  } while (true);
+
+  _pending.erase(0, size);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include "ast.h"
+#include "buffer_tokenizer.h"
+#include "event_parser.h"
+#include "parser.h"
+#include "structure.h"
+#include "util/arena.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+// PushParser parses code that arrives in chunks of any size, e.g. from
+// a non-blocking socket, without ever blocking on its input. Tokens and
+// lists may span chunk boundaries.
+//
+// Only the bytes of the top-level form in flight are buffered: the
+// chunks go through a StructureScanner, and whatever precedes the last
+// top-level boundary is parsed and dropped at the end of every Feed().
+class PushParser {
+ public:
+  PushParser()
+      : _pending(), _scanner(), _ready(),
+        _events(new BufferTokenizer(nullptr, 0)), _builder(),
+        _finished(false), _failed(false) {}
+
+  // Does nothing after Finish() or after an error.
+  void Feed(const char *data, size_t size);
+
+  // Signals the end of the input, so that the last form is parsed even
+  // without anything after it. A form left incomplete is reported as an
+  // error, the same way Parser does at the end of its input.
+  void Finish();
+
+  // Returns the next complete top-level form, or EMPTY when there is
+  // none so far (for good if finished()). After an error, all the
+  // following calls return EMPTY.
+  util::Result<AST> Next();
+
+  inline bool finished() const {
+    return _finished;
+  }
+
+  // The number of bytes kept for the form in flight.
+  inline size_t buffered_size() const {
+    return _pending.size();
+  }
+
+  // Same as Parser::set_arena().
+  inline void set_arena(util::Arena *arena) {
+    _builder.set_resource(arena);
+  }
+
+  inline void set_max_depth(size_t max_depth) {
+    _events.set_max_depth(max_depth);
+  }
+
+ private:
+  PushParser(const PushParser&) = delete;
+  const PushParser &operator=(const PushParser&) = delete;
+
+  // Parses and drops the first size bytes of _pending, which have to end
+  // at a top-level boundary (or be all of them once finished).
+  void ParsePending(size_t size);
+
+  std::string _pending;
+  // Has seen all the bytes in _pending.
+  StructureScanner _scanner;
+  // Parsed forms and errors that Next() has not returned yet.
+  std::deque<util::Result<AST>> _ready;
+  // Kept across the calls to ParsePending(), so that the tokenizer
+  // scratch, the list stack and the cache of interned names are reused
+  // rather than rebuilt for every chunk.
+  EventParser<BufferTokenizer> _events;
+  AstBuilder _builder;
+  bool _finished;
+  bool _failed;
+};
+
+}  // namespace lisparser
@@ -0,0 +1,153 @@
+#include "push_parser.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace lisparser {
+
+namespace {
+std::vector<AST> ParseSerially(const std::string &code) {
+  std::vector<AST> forms;
+  Parser parser(code);
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) {
+      EXPECT_EQ(Parser::EMPTY, form.error_code());
+      return forms;
+    }
+    forms.push_back(std::move(form.value()));
+  } while (true);
+}
+
+// Moves the forms that are ready so far to the end of forms.
+void TakeReady(PushParser *parser, std::vector<AST> *forms) {
+  do {
+    auto form = parser->Next();
+    if (!form.ok()) {
+      EXPECT_EQ(Parser::EMPTY, form.error_code());
+      return;
+    }
+    forms->push_back(std::move(form.value()));
+  } while (true);
+}
+}  // namespace
+
+TEST(PushParser, SplitTokenTest) {
+  PushParser parser;
+  std::vector<AST> forms;
+
+  for (const char *chunk : {"(Def", "un \"a (\\", "\"", " b\" -1", "2.", "5",
+                            ") , sym", "bol ; (\n", "12"}) {
+    parser.Feed(chunk, std::char_traits<char>::length(chunk));
+    TakeReady(&parser, &forms);
+    if (forms.empty()) {
+      EXPECT_NE(0, parser.buffered_size());
+    }
+  }
+
+  // The last number might go on in the next chunk.
+  ASSERT_EQ(2, forms.size());
+  EXPECT_EQ(AST::Vector(AST::Symbol("defun"), AST::String("a (\" b"),
+                        AST::Double(-12.5)),
+            forms[0]);
+  EXPECT_EQ(AST::EvalForm("symbol"), forms[1]);
+  EXPECT_FALSE(parser.finished());
+
+  parser.Finish();
+  TakeReady(&parser, &forms);
+  ASSERT_EQ(3, forms.size());
+  EXPECT_EQ(AST::Integer(12), forms[2]);
+  EXPECT_TRUE(parser.finished());
+}
+
+TEST(PushParser, SameAsParserTest) {
+  std::string code;
+  for (int i = 0; i < 50; ++i) {
+    code += "(defun f" + std::to_string(i) + " (x) \"a ) \\\"string (\" x) ";
+    code += "; a comment with ( and \"\n, evaluated atom;with;semicolons ";
+    code += std::to_string(i) + " -1.5 :key\n";
+  }
+  std::vector<AST> expected = ParseSerially(code);
+
+  for (size_t chunk_size : {1, 2, 3, 7, 64, 4096}) {
+    PushParser parser;
+    std::vector<AST> forms;
+    for (size_t i = 0; i < code.size(); i += chunk_size) {
+      parser.Feed(code.data() + i, std::min(chunk_size, code.size() - i));
+      TakeReady(&parser, &forms);
+    }
+    parser.Finish();
+    TakeReady(&parser, &forms);
+    EXPECT_EQ(expected, forms) << "with chunks of " << chunk_size;
+  }
+}
+
+TEST(PushParser, BoundedBufferTest) {
+  PushParser parser;
+  std::string form = "(a (b \"c\") 12) ";
+  for (int i = 0; i < 1000; ++i) {
+    parser.Feed(form.data(), form.size());
+    EXPECT_EQ(0, parser.buffered_size());
+  }
+
+  parser.Feed(form.data(), 5);
+  EXPECT_EQ(5, parser.buffered_size());
+
+  int num_forms = 0;
+  while (parser.Next().ok()) ++num_forms;
+  EXPECT_EQ(1000, num_forms);
+}
+
+TEST(PushParser, MaxDepthAcrossChunksTest) {
+  PushParser parser;
+  parser.set_max_depth(2);
+  parser.Feed("((a)) ", 6);
+  parser.Feed("(b) ((c", 7);
+  parser.Feed(")) (((d))) ", 11);
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(parser.Next().ok());
+  }
+  EXPECT_EQ(Parser::TOO_DEEP, parser.Next().error_code());
+  EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+}
+
+TEST(PushParser, IncompleteFormTest) {
+  PushParser parser;
+  std::string code = "(a b) (c (d)";
+  parser.Feed(code.data(), code.size());
+  parser.Finish();
+
+  auto first = parser.Next();
+  ASSERT_TRUE(first.ok());
+  EXPECT_EQ(AST::Vector(AST::Symbol("a"), AST::Symbol("b")), first.value());
+  EXPECT_EQ(Parser::UNMATCHED_PAREN, parser.Next().error_code());
+  EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+}
+
+TEST(PushParser, ErrorStopsParsingTest) {
+  PushParser parser;
+  std::string code = "a ) b ";
+  parser.Feed(code.data(), code.size());
+  parser.Feed("c ", 2);
+
+  EXPECT_TRUE(parser.Next().ok());
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, parser.Next().error_code());
+  EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+  EXPECT_EQ(0, parser.buffered_size());
+}
+
+TEST(PushParser, TokenizerErrorTest) {
+  PushParser parser;
+  std::string code = "a \"bad \\escape\" b";
+  parser.Feed(code.data(), code.size());
+  parser.Finish();
+
+  EXPECT_TRUE(parser.Next().ok());
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, parser.Next().error_code());
+  EXPECT_EQ(Parser::EMPTY, parser.Next().error_code());
+}
+
+}  // namespace lisparser
@@ -0,0 +1,213 @@
+#include "serializer.h"
+
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+namespace lisparser {
+
+namespace {
+// Long enough for any double in fixed notation, the longest being the
+// negative subnormals with their 323 leading zeros.
+constexpr size_t MAX_DOUBLE_LENGTH = 512;
+constexpr size_t MAX_INTEGER_LENGTH = 24;
+
+// Formats the double so that it reads back as the same double, and as a
+// double rather than an integer. Only finite doubles do: infinities and
+// NaNs come out as "inf", "-inf" or "nan", which read back as symbols,
+// or for "-inf" not at all.
+size_t FormatDouble(double value, char *output) {
+  std::to_chars_result result = std::to_chars(
+      output, output + MAX_DOUBLE_LENGTH - 2, value,
+      std::chars_format::fixed);
+  size_t length = result.ptr - output;
+  bool finite = length > 0 &&
+      (output[length - 1] >= '0' && output[length - 1] <= '9');
+  if (finite && std::memchr(output, '.', length) == nullptr) {
+    output[length++] = '.';
+    output[length++] = '0';
+  }
+  return length;
+}
+
+size_t EscapedSize(std::string_view content) {
+  size_t size = content.size() + 2;
+  for (char character : content) {
+    if (character == '"' || character == '\\') ++size;
+  }
+  return size;
+}
+}  // namespace
+
+void Serializer::Write(const AST &ast) {
+  WriteInline(ast);
+  _buffer.push_back('\n');
+}
+
+void Serializer::WriteInline(const AST &ast) {
+  if (_mode == PRETTY) {
+    WritePretty(ast, 0);
+  } else {
+    WriteCompact(ast);
+  }
+}
+
+std::string Serializer::Release() {
+  std::string released;
+  released.swap(_buffer);
+  return released;
+}
+
+util::Result<bool> Serializer::Flush(int fd) {
+  size_t written = 0;
+  while (written < _buffer.size()) {
+    ssize_t result = ::write(fd, _buffer.data() + written,
+                             _buffer.size() - written);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      int error = errno;
+      _buffer.erase(0, written);
+      return util::Result<bool>(
+          WRITE_FAILED, util::StrCat("Cannot write: ", std::strerror(error)));
+    }
+    written += static_cast<size_t>(result);
+  }
+  _buffer.clear();
+  return true;
+}
+
+void Serializer::WriteCompact(const AST &ast) {
+  switch (ast.type()) {
+    case AST::KEYWORD:
+    case AST::SYMBOL:
+      _buffer.append(ast.AsString());
+      break;
+
+    case AST::EVAL_FORM:
+      _buffer.push_back(',');
+      _buffer.append(ast.AsString());
+      break;
+
+    case AST::STRING:
+      WriteString(ast.AsString());
+      break;
+
+    case AST::INTEGER:
+      WriteInteger(ast.AsInt64());
+      break;
+
+    case AST::FLOAT:
+      WriteDouble(ast.AsDouble());
+      break;
+
+    case AST::LIST: {
+      _buffer.push_back('(');
+      bool first = true;
+      for (const AST &element : ast.AsVector()) {
+        if (!first) _buffer.push_back(' ');
+        WriteCompact(element);
+        first = false;
+      }
+      _buffer.push_back(')');
+      break;
+    }
+  }
+}
+
+void Serializer::WritePretty(const AST &ast, size_t column) {
+  size_t room = _width > column ? _width - column : 0;
+  if (ast.type() != AST::LIST || ast.AsVector().empty() ||
+      CompactWidth(ast, room) <= room) {
+    WriteCompact(ast);
+    return;
+  }
+
+  // The children go right after the paren, one per line.
+  _buffer.push_back('(');
+  bool first = true;
+  for (const AST &element : ast.AsVector()) {
+    if (!first) {
+      _buffer.push_back('\n');
+      _buffer.append(column + 1, ' ');
+    }
+    WritePretty(element, column + 1);
+    first = false;
+  }
+  _buffer.push_back(')');
+}
+
+size_t Serializer::CompactWidth(const AST &ast, size_t limit) const {
+  switch (ast.type()) {
+    case AST::KEYWORD:
+    case AST::SYMBOL:
+      return ast.AsString().size();
+
+    case AST::EVAL_FORM:
+      return ast.AsString().size() + 1;
+
+    case AST::STRING:
+      return EscapedSize(ast.AsString());
+
+    case AST::INTEGER: {
+      char digits[MAX_INTEGER_LENGTH];
+      return std::to_chars(digits, digits + sizeof(digits), ast.AsInt64())
+          .ptr - digits;
+    }
+
+    case AST::FLOAT: {
+      char digits[MAX_DOUBLE_LENGTH];
+      return FormatDouble(ast.AsDouble(), digits);
+    }
+
+    case AST::LIST: {
+      // The parens, and the spaces between the children.
+      size_t width = ast.AsVector().empty() ? 2 : 1 + ast.AsVector().size();
+      for (const AST &element : ast.AsVector()) {
+        if (width > limit) break;
+        width += CompactWidth(element, limit - width);
+      }
+      return width;
+    }
+  }
+
+  // Unreachable, see AST::operator==.
+  return 0;
+}
+
+void Serializer::WriteString(std::string_view content) {
+  _buffer.push_back('"');
+  size_t start = 0;
+  do {
+    size_t escape = content.find_first_of("\"\\", start);
+    if (escape == std::string_view::npos) {
+      _buffer.append(content.substr(start));
+      break;
+    }
+    _buffer.append(content.substr(start, escape - start));
+    _buffer.push_back('\\');
+    _buffer.push_back(content[escape]);
+    start = escape + 1;
+  } while (true);
+  _buffer.push_back('"');
+}
+
+void Serializer::WriteInteger(int64_t value) {
+  char digits[MAX_INTEGER_LENGTH];
+  std::to_chars_result result =
+      std::to_chars(digits, digits + sizeof(digits), value);
+  _buffer.append(digits, result.ptr - digits);
+}
+
+void Serializer::WriteDouble(double value) {
+  char digits[MAX_DOUBLE_LENGTH];
+  _buffer.append(digits, FormatDouble(value, digits));
+}
+
+std::string Serialize(const AST &ast) {
+  Serializer serializer;
+  serializer.WriteInline(ast);
+  return serializer.Release();
+}
+
+}  // namespace lisparser
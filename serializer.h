@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "ast.h"
+#include "util/result.h"
+
+namespace lisparser {
+
+enum SerializerError {
+  WRITE_FAILED = 1,
+};
+
+// Serializer writes ASTs as code into a growable buffer, which can be
+// flushed to a file descriptor as it fills up. Numbers are formatted
+// with std::to_chars, independently of the locale, and strings are
+// escaped, so that Parser reads the output back into equal ASTs. (Doubles
+// come back exactly, and always with a dot so that they stay doubles.)
+//
+// This holds for any AST that Parser can produce, which never holds
+// infinite or NaN doubles. Those have no syntax and are written as
+// to_chars does: "inf" and "nan" read back as symbols, and "-inf" is a
+// tokenizer error. Names that are not valid tokens are written as they
+// are too.
+class Serializer {
+ public:
+  enum Mode {
+    // Every form on a single line, with single spaces.
+    COMPACT = 0,
+    // Lists that do not fit in the line width are broken after their
+    // first child, with one child per line, indented under the first.
+    PRETTY = 1,
+  };
+
+  // When streaming large outputs, a good size() at which to Flush().
+  static constexpr size_t FLUSH_SIZE = 1 << 16;
+
+  explicit Serializer(Mode mode = COMPACT, size_t width = 80)
+      : _mode(mode), _width(width), _buffer() {}
+
+  // Appends the form, followed by a line break.
+  void Write(const AST &ast);
+
+  // Appends the form only, on the current line.
+  void WriteInline(const AST &ast);
+
+  inline std::string_view buffer() const {
+    return _buffer;
+  }
+
+  inline size_t size() const {
+    return _buffer.size();
+  }
+
+  // Takes the content of the buffer, which is left empty.
+  std::string Release();
+
+  // Writes the whole buffer to the file descriptor, and empties it. On
+  // failure, the part that has not been written is kept.
+  util::Result<bool> Flush(int fd);
+
+ private:
+  Serializer(const Serializer&) = delete;
+  const Serializer &operator=(const Serializer&) = delete;
+
+  void WriteCompact(const AST &ast);
+
+  // Writes the node starting at column, which is where it ends up when
+  // its list is broken.
+  void WritePretty(const AST &ast, size_t column);
+
+  // The width of the node in compact mode, or anything larger than
+  // limit if it is larger than that, which is all that is looked at.
+  size_t CompactWidth(const AST &ast, size_t limit) const;
+
+  void WriteString(std::string_view content);
+  void WriteInteger(int64_t value);
+  void WriteDouble(double value);
+
+  Mode _mode;
+  size_t _width;
+  std::string _buffer;
+};
+
+// Returns the form as compact code, without a line break.
+std::string Serialize(const AST &ast);
+
+}  // namespace lisparser
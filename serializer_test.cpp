@@ -0,0 +1,181 @@
+#include "serializer.h"
+
+#include <unistd.h>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "parser.h"
+
+namespace lisparser {
+
+namespace {
+std::vector<AST> ParseAll(const std::string &code) {
+  std::vector<AST> forms;
+  Parser parser(code);
+  do {
+    auto form = parser.Next();
+    if (!form.ok()) {
+      EXPECT_EQ(Parser::EMPTY, form.error_code()) << form.error_message();
+      return forms;
+    }
+    forms.push_back(std::move(form.value()));
+  } while (true);
+}
+
+// Checks that both modes write code that reads back into the same forms.
+void ExpectRoundTrip(const std::string &code) {
+  std::vector<AST> forms = ParseAll(code);
+  for (Serializer::Mode mode : {Serializer::COMPACT, Serializer::PRETTY}) {
+    Serializer serializer(mode, 16);
+    for (const AST &form : forms) {
+      serializer.Write(form);
+    }
+    std::vector<AST> parsed = ParseAll(serializer.Release());
+    EXPECT_EQ(forms, parsed) << "in " << code;
+  }
+}
+}  // namespace
+
+TEST(Serializer, CompactTest) {
+  AST ast = AST::Vector(
+      AST::Keyword(":abc"),
+      AST::Vector(
+          AST::Integer(-3115),
+          AST::Vector(AST::Symbol("xyz"), AST::Vector()),
+          AST::Double(4.18),
+          AST::EvalForm("some-variable")),
+      AST::String("a \"quoted\" \\ string"),
+      AST::Double(5.0),
+      AST::Double(-0.5));
+
+  EXPECT_EQ("(:abc (-3115 (xyz ()) 4.18 ,some-variable) "
+            "\"a \\\"quoted\\\" \\\\ string\" 5.0 -0.5)",
+            Serialize(ast));
+
+  std::ostringstream output;
+  output << ast;
+  EXPECT_EQ(Serialize(ast), output.str());
+}
+
+TEST(Serializer, PrettyTest) {
+  std::vector<AST> forms = ParseAll(
+      "(defun fib (n) (if (< n 2) n (+ (fib (sub n 1)) (fib (sub n 2)))))");
+  Serializer serializer(Serializer::PRETTY, 24);
+  serializer.Write(forms[0]);
+
+  EXPECT_EQ("(defun\n"
+            " fib\n"
+            " (n)\n"
+            " (if\n"
+            "  (< n 2)\n"
+            "  n\n"
+            "  (+\n"
+            "   (fib (sub n 1))\n"
+            "   (fib (sub n 2)))))\n",
+            serializer.buffer());
+
+  // Whatever fits stays on one line.
+  Serializer wide(Serializer::PRETTY, 80);
+  wide.Write(forms[0]);
+  EXPECT_EQ(Serialize(forms[0]) + "\n", wide.buffer());
+}
+
+TEST(Serializer, StringRoundTripTest) {
+  std::vector<std::string> contents = {
+    "", "\"", "\\", "\\\"", "\"\"\"", "ends with a backslash \\",
+    "a (paren) ; and a semicolon\nover two lines",
+    "a string long enough to live out of line, with \"quotes\"",
+  };
+  for (const std::string &content : contents) {
+    std::vector<AST> parsed = ParseAll(Serialize(AST::String(content)));
+    ASSERT_EQ(1, parsed.size());
+    EXPECT_EQ(content, parsed[0].AsString());
+  }
+}
+
+TEST(Serializer, NumberRoundTripTest) {
+  std::vector<int64_t> integers = {
+    0, -1, 42, std::numeric_limits<int64_t>::max(),
+    std::numeric_limits<int64_t>::min(),
+  };
+  for (int64_t integer : integers) {
+    std::vector<AST> parsed = ParseAll(Serialize(AST::Integer(integer)));
+    ASSERT_EQ(1, parsed.size());
+    ASSERT_EQ(AST::INTEGER, parsed[0].type());
+    EXPECT_EQ(integer, parsed[0].AsInt64());
+  }
+
+  std::vector<double> doubles = {
+    0.0, -0.0, 1.0, -7.0, 0.1, 1.0 / 3, 123456789.125, 1e22, 1e300,
+    std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::min(),
+  };
+  for (double real : doubles) {
+    std::string code = Serialize(AST::Double(real));
+    std::vector<AST> parsed = ParseAll(code);
+    ASSERT_EQ(1, parsed.size()) << code;
+    ASSERT_EQ(AST::FLOAT, parsed[0].type()) << code;
+    // Exactly, down to the sign of zeros.
+    double read = parsed[0].AsDouble();
+    EXPECT_EQ(0, std::memcmp(&real, &read, sizeof(real))) << code;
+  }
+}
+
+TEST(Serializer, NonFiniteDoubleTest) {
+  // There is no syntax for them, so they are written the way to_chars
+  // does, and do not come back as doubles.
+  double infinity = std::numeric_limits<double>::infinity();
+  EXPECT_EQ("inf", Serialize(AST::Double(infinity)));
+  EXPECT_EQ("-inf", Serialize(AST::Double(-infinity)));
+  EXPECT_EQ("nan",
+            Serialize(AST::Double(std::numeric_limits<double>::quiet_NaN())));
+  EXPECT_EQ("(inf 1.0)", Serialize(AST::Vector(AST::Double(infinity),
+                                               AST::Double(1.0))));
+
+  std::vector<AST> parsed = ParseAll(Serialize(AST::Double(infinity)));
+  ASSERT_EQ(1, parsed.size());
+  EXPECT_EQ(AST::SYMBOL, parsed[0].type());
+
+  Parser parser(Serialize(AST::Double(-infinity)));
+  auto form = parser.Next();
+  ASSERT_FALSE(form.ok());
+  EXPECT_EQ(Parser::TOKENIZER_EXCEPTION, form.error_code());
+}
+
+TEST(Serializer, RoundTripTest) {
+  ExpectRoundTrip("(:a (:Nice-Keyword)) () ((())) (a ,b)");
+  ExpectRoundTrip("(Defmethod a (B \"C\" D) ,e \"x\\\"y\\\\z\")");
+  ExpectRoundTrip("(12 (11.52) -.88 -15 1.) 9223372036854775807");
+  ExpectRoundTrip(
+      "(let ((a-long-variable-name 1) (another-one \"with a string\"))\n"
+      "  (do-something a-long-variable-name another-one (nested (deeper "
+      "(and-deeper :still))))) ;; comment\n"
+      "(defun fib (n) (if (< n 2) n (+ (fib (sub n 1)) (fib (sub n 2)))))");
+}
+
+TEST(Serializer, FlushTest) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  Serializer serializer;
+  serializer.Write(AST::Vector(AST::Symbol("a"), AST::Integer(1)));
+  serializer.Write(AST::String("b"));
+  ASSERT_TRUE(serializer.Flush(fds[1]).ok());
+  EXPECT_EQ(0, serializer.size());
+  close(fds[1]);
+
+  char content[64];
+  ssize_t size = read(fds[0], content, sizeof(content));
+  close(fds[0]);
+  EXPECT_EQ("(a 1)\n\"b\"\n", std::string(content, size > 0 ? size : 0));
+
+  serializer.Write(AST::Symbol("kept"));
+  auto result = serializer.Flush(-1);
+  EXPECT_EQ(WRITE_FAILED, result.error_code());
+  EXPECT_EQ("kept\n", serializer.buffer());
+}
+
+}  // namespace lisparser
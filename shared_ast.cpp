@@ -0,0 +1,273 @@
+#include "shared_ast.h"
+
+#include <cstring>
+#include <functional>
+
+namespace lisparser {
+
+namespace {
+// Mixes a value into a hash, as boost::hash_combine does.
+inline size_t Combine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+inline uint64_t Bits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+}  // namespace
+
+AST::Type SharedAST::type() const {
+  return _node->type;
+}
+
+std::string_view SharedAST::AsString() const {
+  if (_node->type == AST::STRING) return _node->string;
+  return _node->symbol.name();
+}
+
+SymbolId SharedAST::AsSymbol() const {
+  assert(_node->type == AST::KEYWORD || _node->type == AST::SYMBOL ||
+         _node->type == AST::EVAL_FORM);
+  return _node->symbol;
+}
+
+int64_t SharedAST::AsInt64() const {
+  return _node->integer;
+}
+
+double SharedAST::AsDouble() const {
+  return _node->real;
+}
+
+const std::vector<SharedAST> &SharedAST::AsVector() const {
+  return _node->children;
+}
+
+size_t SharedAST::hash() const {
+  return _node->hash;
+}
+
+AST::HeadSet SharedAST::heads() const {
+  return _node->heads;
+}
+
+AST SharedAST::ToAST(std::pmr::memory_resource *resource) const {
+  switch (_node->type) {
+    case AST::KEYWORD:
+      return AST::Keyword(_node->symbol);
+
+    case AST::SYMBOL:
+      return AST::Symbol(_node->symbol);
+
+    case AST::EVAL_FORM:
+      return AST::EvalForm(_node->symbol);
+
+    case AST::STRING:
+      return AST::String(_node->string, resource);
+
+    case AST::INTEGER:
+      return AST::Integer(_node->integer);
+
+    case AST::FLOAT:
+      return AST::Double(_node->real);
+
+    case AST::LIST: {
+      AST result = AST::Vector(resource);
+      result.Reserve(_node->children.size());
+      for (const SharedAST &child : _node->children) {
+        result.Push(child.ToAST(resource));
+      }
+      return result;
+    }
+  }
+
+  // Unreachable, see AST::operator==.
+  return AST::Vector(resource);
+}
+
+void SharedAST::Acquire() {
+  if (_node != nullptr) ++_node->references;
+}
+
+void SharedAST::Release() {
+  if (_node == nullptr || --_node->references > 0) return;
+  _node->pool->Erase(_node);
+  // Releases the children as well.
+  delete _node;
+}
+
+std::ostream &operator<<(std::ostream &output, const SharedAST &ast) {
+  return output << ast.ToAST();
+}
+
+SharedAstPool::~SharedAstPool() {
+  assert(_nodes.empty());
+}
+
+SharedAST SharedAstPool::Keyword(SymbolId name) {
+  internal::SharedNode node(AST::KEYWORD);
+  node.symbol = name;
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::Symbol(SymbolId name) {
+  internal::SharedNode node(AST::SYMBOL);
+  node.symbol = name;
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::EvalForm(SymbolId variable) {
+  internal::SharedNode node(AST::EVAL_FORM);
+  node.symbol = variable;
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::String(std::string_view content) {
+  internal::SharedNode node(AST::STRING);
+  node.string.assign(content.data(), content.size());
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::Integer(int64_t value) {
+  internal::SharedNode node(AST::INTEGER);
+  node.integer = value;
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::Double(double value) {
+  internal::SharedNode node(AST::FLOAT);
+  node.real = value;
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::List(std::vector<SharedAST> &&children) {
+  internal::SharedNode node(AST::LIST);
+  node.children = std::move(children);
+  for (const SharedAST &child : node.children) {
+    node.heads |= child.heads();
+  }
+  if (!node.children.empty() && node.children[0].type() == AST::KEYWORD) {
+    node.heads |= AST::HeadBit(node.children[0].AsSymbol());
+  }
+  return Intern(std::move(node));
+}
+
+SharedAST SharedAstPool::FromAST(const AST &ast) {
+  switch (ast.type()) {
+    case AST::KEYWORD:
+      return Keyword(ast.AsSymbol());
+
+    case AST::SYMBOL:
+      return Symbol(ast.AsSymbol());
+
+    case AST::EVAL_FORM:
+      return EvalForm(ast.AsSymbol());
+
+    case AST::STRING:
+      return String(ast.AsString());
+
+    case AST::INTEGER:
+      return Integer(ast.AsInt64());
+
+    case AST::FLOAT:
+      return Double(ast.AsDouble());
+
+    case AST::LIST: {
+      std::vector<SharedAST> children;
+      children.reserve(ast.AsVector().size());
+      for (const AST &child : ast.AsVector()) {
+        children.push_back(FromAST(child));
+      }
+      return List(std::move(children));
+    }
+  }
+
+  // Unreachable, see AST::operator==.
+  return List({});
+}
+
+size_t SharedAstPool::NodeHash::operator()(
+    const internal::SharedNode *node) const {
+  return node->hash;
+}
+
+bool SharedAstPool::NodeEqual::operator()(
+    const internal::SharedNode *left,
+    const internal::SharedNode *right) const {
+  if (left->type != right->type) return false;
+
+  switch (left->type) {
+    case AST::KEYWORD:
+    case AST::SYMBOL:
+    case AST::EVAL_FORM:
+      return left->symbol == right->symbol;
+
+    case AST::STRING:
+      return left->string == right->string;
+
+    case AST::INTEGER:
+      return left->integer == right->integer;
+
+    case AST::FLOAT:
+      // Bitwise, so that 0.0 and -0.0 stay apart.
+      return Bits(left->real) == Bits(right->real);
+
+    case AST::LIST:
+      // The children are interned, so comparing them is comparing their
+      // nodes.
+      return left->children == right->children;
+  }
+
+  return false;
+}
+
+SharedAST SharedAstPool::Intern(internal::SharedNode &&candidate) {
+  size_t hash = std::hash<int>()(candidate.type);
+  switch (candidate.type) {
+    case AST::KEYWORD:
+    case AST::SYMBOL:
+    case AST::EVAL_FORM:
+      hash = Combine(hash, candidate.symbol.hash());
+      break;
+
+    case AST::STRING:
+      hash = Combine(hash, std::hash<std::string>()(candidate.string));
+      break;
+
+    case AST::INTEGER:
+      hash = Combine(hash, std::hash<int64_t>()(candidate.integer));
+      break;
+
+    case AST::FLOAT:
+      hash = Combine(hash, std::hash<uint64_t>()(Bits(candidate.real)));
+      break;
+
+    case AST::LIST:
+      for (const SharedAST &child : candidate.children) {
+        hash = Combine(hash, child.hash());
+      }
+      break;
+  }
+  candidate.hash = hash;
+
+  auto iter = _nodes.find(&candidate);
+  if (iter != _nodes.end()) {
+    SharedAST shared(*iter);
+    shared.Acquire();
+    return shared;
+  }
+
+  internal::SharedNode *node = new internal::SharedNode(std::move(candidate));
+  node->pool = this;
+  node->references = 1;
+  _nodes.insert(node);
+  return SharedAST(node);
+}
+
+void SharedAstPool::Erase(internal::SharedNode *node) {
+  _nodes.erase(node);
+}
+
+}  // namespace lisparser
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "ast.h"
+#include "symbol.h"
+
+namespace lisparser {
+
+class SharedAstPool;
+
+namespace internal {
+struct SharedNode;
+}  // namespace internal
+
+// SharedAST is an immutable AST whose nodes are hash-consed by a
+// SharedAstPool: structurally equal subtrees are stored once, and are
+// shared by all the trees that contain them. Copying a SharedAST only
+// bumps a reference count, and comparing two of them from the same pool
+// is a pointer comparison.
+//
+// Like the pool, SharedASTs are not thread-safe.
+class SharedAST {
+ public:
+  SharedAST(const SharedAST &other) : _node(other._node) {
+    Acquire();
+  }
+
+  SharedAST(SharedAST &&other) noexcept : _node(other._node) {
+    other._node = nullptr;
+  }
+
+  SharedAST &operator=(const SharedAST &other) {
+    SharedAST copy(other);
+    std::swap(_node, copy._node);
+    return *this;
+  }
+
+  SharedAST &operator=(SharedAST &&other) noexcept {
+    std::swap(_node, other._node);
+    return *this;
+  }
+
+  ~SharedAST() {
+    Release();
+  }
+
+  // Only meaningful for SharedASTs from the same pool.
+  inline bool operator==(const SharedAST &other) const {
+    return _node == other._node;
+  }
+
+  inline bool operator!=(const SharedAST &other) const {
+    return _node != other._node;
+  }
+
+  AST::Type type() const;
+
+  // Also returns the names of symbols, keywords and eval forms.
+  std::string_view AsString() const;
+
+  // Only for symbols, keywords and eval forms.
+  SymbolId AsSymbol() const;
+
+  int64_t AsInt64() const;
+
+  double AsDouble() const;
+
+  const std::vector<SharedAST> &AsVector() const;
+
+  // A hash of the structure of the tree.
+  size_t hash() const;
+
+  // The keywords at the head of the lists in the tree, see AST::heads().
+  AST::HeadSet heads() const;
+
+  // Builds an AST with the same structure, allocated from the resource.
+  AST ToAST(std::pmr::memory_resource *resource =
+            std::pmr::get_default_resource()) const;
+
+ private:
+  friend class SharedAstPool;
+
+  // Takes over a reference to the node.
+  explicit SharedAST(internal::SharedNode *node) : _node(node) {}
+
+  void Acquire();
+  void Release();
+
+  internal::SharedNode *_node;
+};
+
+std::ostream &operator<<(std::ostream &output, const SharedAST &ast);
+
+// SharedAstPool creates the SharedASTs, and makes sure that there is
+// only one node for every distinct subtree. A node is removed from the
+// pool when the last SharedAST that refers to it goes away, so the pool
+// has to outlive all the SharedASTs it created.
+class SharedAstPool {
+ public:
+  SharedAstPool() : _nodes() {}
+
+  ~SharedAstPool();
+
+  SharedAST Keyword(SymbolId name);
+  SharedAST Symbol(SymbolId name);
+  SharedAST EvalForm(SymbolId variable);
+  SharedAST String(std::string_view content);
+  SharedAST Integer(int64_t value);
+  SharedAST Double(double value);
+  SharedAST List(std::vector<SharedAST> &&children);
+
+  // Interns the whole tree.
+  SharedAST FromAST(const AST &ast);
+
+  // The number of distinct nodes alive.
+  inline size_t size() const {
+    return _nodes.size();
+  }
+
+ private:
+  friend class SharedAST;
+
+  SharedAstPool(const SharedAstPool&) = delete;
+  const SharedAstPool &operator=(const SharedAstPool&) = delete;
+
+  struct NodeHash {
+    size_t operator()(const internal::SharedNode *node) const;
+  };
+
+  struct NodeEqual {
+    bool operator()(const internal::SharedNode *left,
+                    const internal::SharedNode *right) const;
+  };
+
+  // Returns the node equal to the candidate if there is one already, or
+  // the candidate itself otherwise.
+  SharedAST Intern(internal::SharedNode &&candidate);
+
+  void Erase(internal::SharedNode *node);
+
+  std::unordered_set<internal::SharedNode*, NodeHash, NodeEqual> _nodes;
+};
+
+namespace internal {
+struct SharedNode {
+  SharedNode(AST::Type input_type)
+      : type(input_type), hash(0), heads(0), references(0), pool(nullptr),
+        integer(0), string(), children() {}
+
+  AST::Type type;
+  size_t hash;
+  AST::HeadSet heads;
+  size_t references;
+  SharedAstPool *pool;
+  union {
+    int64_t integer;
+    double real;
+    SymbolId symbol;
+  };
+  // The content of strings.
+  std::string string;
+  std::vector<SharedAST> children;
+};
+}  // namespace internal
+
+}  // namespace lisparser
+
+namespace std {
+template <>
+struct hash<lisparser::SharedAST> {
+  size_t operator()(const lisparser::SharedAST &ast) const {
+    return ast.hash();
+  }
+};
+}  // namespace std
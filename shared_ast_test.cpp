@@ -0,0 +1,101 @@
+#include "shared_ast.h"
+
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace lisparser {
+
+namespace {
+AST MakeForm() {
+  return AST::Vector(
+      AST::Symbol("defun"), AST::Keyword(":key"), AST::EvalForm("x"),
+      AST::String("a string longer than the inline capacity"),
+      AST::Vector(AST::Integer(12), AST::Double(-1.5)),
+      AST::Vector(AST::Integer(12), AST::Double(-1.5)));
+}
+}  // namespace
+
+TEST(SharedAST, RoundTripTest) {
+  SharedAstPool pool;
+  SharedAST shared = pool.FromAST(MakeForm());
+
+  EXPECT_EQ(AST::LIST, shared.type());
+  EXPECT_EQ(6, shared.AsVector().size());
+  EXPECT_EQ("defun", shared.AsVector()[0].AsString());
+  EXPECT_EQ(AST::Keyword(":key").AsSymbol(),
+            shared.AsVector()[1].AsSymbol());
+  EXPECT_EQ(12, shared.AsVector()[4].AsVector()[0].AsInt64());
+  EXPECT_EQ(-1.5, shared.AsVector()[4].AsVector()[1].AsDouble());
+  EXPECT_EQ(MakeForm(), shared.ToAST());
+}
+
+TEST(SharedAST, HeadsTest) {
+  SharedAstPool pool;
+  AST ast = AST::Vector(
+      AST::Symbol("f"),
+      AST::Vector(AST::Keyword(":abc"), AST::Integer(1)),
+      AST::Vector(AST::Integer(2), AST::Keyword(":xyz")));
+  SharedAST shared = pool.FromAST(ast);
+  EXPECT_EQ(AST::HeadBit(SymbolId::Intern(":abc")), shared.heads());
+  EXPECT_EQ(ast.heads(), shared.heads());
+  EXPECT_EQ(0, shared.AsVector()[2].heads());
+}
+
+TEST(SharedAST, SharingTest) {
+  SharedAstPool pool;
+  SharedAST first = pool.FromAST(MakeForm());
+  SharedAST second = pool.FromAST(MakeForm());
+
+  // The same node, so equal by pointer.
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(first.hash(), second.hash());
+  // Both (12 -1.5) are one node.
+  EXPECT_EQ(first.AsVector()[4], first.AsVector()[5]);
+  // The list, its 4 atoms, (12 -1.5) and its 2 atoms.
+  EXPECT_EQ(8, pool.size());
+
+  SharedAST other = pool.FromAST(AST::Vector(AST::Integer(12),
+                                             AST::Double(1.5)));
+  EXPECT_NE(first.AsVector()[4], other);
+  EXPECT_EQ(first.AsVector()[4].AsVector()[0], other.AsVector()[0]);
+  EXPECT_EQ(10, pool.size());
+}
+
+TEST(SharedAST, DoubleTest) {
+  SharedAstPool pool;
+  EXPECT_EQ(pool.Double(1.5), pool.Double(1.5));
+  EXPECT_NE(pool.Double(0.0), pool.Double(-0.0));
+  EXPECT_NE(pool.Double(1.0), pool.Integer(1));
+}
+
+TEST(SharedAST, ReleaseTest) {
+  SharedAstPool pool;
+  {
+    SharedAST first = pool.FromAST(MakeForm());
+    SharedAST copy = first;
+    {
+      SharedAST child = first.AsVector()[4];
+      first = pool.Integer(7);
+      EXPECT_EQ(AST::Vector(AST::Integer(12), AST::Double(-1.5)),
+                child.ToAST());
+      copy = std::move(child);
+    }
+    // Only (12 -1.5), its atoms and 7 are left.
+    EXPECT_EQ(4, pool.size());
+  }
+  EXPECT_EQ(0, pool.size());
+}
+
+TEST(SharedAST, ListTest) {
+  SharedAstPool pool;
+  std::vector<SharedAST> children;
+  children.push_back(pool.Symbol(SymbolId::Intern("a")));
+  children.push_back(pool.String("b"));
+  SharedAST list = pool.List(std::move(children));
+
+  EXPECT_EQ(AST::Vector(AST::Symbol("a"), AST::String("b")), list.ToAST());
+  EXPECT_EQ(list, pool.FromAST(list.ToAST()));
+  EXPECT_EQ(pool.List({}), pool.FromAST(AST::Vector()));
+}
+
+}  // namespace lisparser
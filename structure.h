@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include "util/char_ops.h"
+
+namespace lisparser {
+
+// StructureScanner follows the input one character at a time and
+// tracks just enough of the tokenizer state (strings, escapes,
+// comments, atoms) to know the paren depth and where top-level forms
+// end, which is much cheaper than tokenizing.
+//
+// Note that ';' only starts a comment between tokens, since it is a
+// symbol character otherwise.
+class StructureScanner {
+ public:
+  enum State {
+    START = 0,
+    // In a symbol or keyword.
+    ATOM = 1,
+    NUMBER = 2,
+    STRING = 3,
+    ESCAPE = 4,
+    COMMENT = 5,
+  };
+
+  StructureScanner() : _state(START), _depth(0), _after_comma(false) {}
+
+  void Feed(char character) {
+    using namespace util::char_ops;
+
+    CharClass char_class =
+        CLASS_TABLE[static_cast<unsigned char>(character)];
+
+    switch (_state) {
+      case ATOM:
+        if (SymbolCharacter(static_cast<unsigned char>(character))) return;
+        break;
+
+      case NUMBER:
+        if (char_class == DIGIT || char_class == DOT) return;
+        break;
+
+      case STRING:
+        if (char_class == QUOTE) {
+          _state = START;
+        } else if (char_class == BACKSLASH) {
+          _state = ESCAPE;
+        }
+        return;
+
+      case ESCAPE:
+        if (char_class == QUOTE || char_class == BACKSLASH) {
+          _state = STRING;
+          return;
+        }
+        // An invalid escape ends the string token right before this
+        // character.
+        break;
+
+      case COMMENT:
+        if (char_class == LINE_END) _state = START;
+        return;
+
+      case START:
+        break;
+    }
+
+    // The character starts a new token (or is skipped).
+    _state = START;
+    switch (char_class) {
+      case WHITESPACE:
+      case LINE_END:
+        return;
+      case SEMICOLON:
+        _state = COMMENT;
+        return;
+      case COMMA:
+        _after_comma = true;
+        return;
+      case OPEN_PAREN:
+        ++_depth;
+        break;
+      case CLOSE_PAREN:
+        // Unmatched closing parens are reported by the parser.
+        if (_depth > 0) --_depth;
+        break;
+      case QUOTE:
+        _state = STRING;
+        break;
+      case DIGIT:
+      case DOT:
+      case MINUS:
+        _state = NUMBER;
+        break;
+      case INVALID:
+        break;
+      default:
+        _state = ATOM;
+        break;
+    }
+    _after_comma = false;
+  }
+
+  // Whether the characters fed so far end right between two top-level
+  // forms, so that the rest can be parsed on its own.
+  inline bool AtTopLevelBoundary() const {
+    return _state == START && _depth == 0 && !_after_comma;
+  }
+
+  inline State state() const {
+    return _state;
+  }
+
+  inline size_t depth() const {
+    return _depth;
+  }
+
+ private:
+  State _state;
+  size_t _depth;
+  // Whether the last token was a comma, which belongs to the next one.
+  bool _after_comma;
+};
+
+}  // namespace lisparser
@@ -0,0 +1,66 @@
+#include "symbol.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace lisparser {
+
+namespace {
+// The table is split into shards with their own locks, so that threads
+// interning different names rarely contend.
+constexpr size_t NUM_SHARDS = 16;
+
+struct Entry {
+  explicit Entry(std::string_view input_name)
+      : name(input_name), view(name) {}
+
+  std::string name;
+  // What SymbolIds point to.
+  std::string_view view;
+};
+
+struct Shard {
+  std::mutex mutex;
+  // Keys point into the entries, whose addresses are stable.
+  std::unordered_map<std::string_view, std::unique_ptr<Entry>> entries;
+};
+
+std::atomic<size_t> num_entries(0);
+
+Shard *GetShards() {
+  // Intentionally leaked, so that SymbolIds stay valid during static
+  // destruction.
+  static Shard *shards = new Shard[NUM_SHARDS];
+  return shards;
+}
+}  // namespace
+
+SymbolId SymbolId::Intern(std::string_view name) {
+  size_t hash = std::hash<std::string_view>()(name);
+  Shard &shard = GetShards()[hash % NUM_SHARDS];
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto iter = shard.entries.find(name);
+  if (iter != shard.entries.end()) {
+    return SymbolId(&iter->second->view);
+  }
+
+  std::unique_ptr<Entry> entry(new Entry(name));
+  const std::string_view *result = &entry->view;
+  shard.entries.emplace(entry->view, std::move(entry));
+  num_entries.fetch_add(1, std::memory_order_relaxed);
+  return SymbolId(result);
+}
+
+size_t SymbolId::num_interned() {
+  return num_entries.load(std::memory_order_relaxed);
+}
+
+std::ostream &operator<<(std::ostream &output, const SymbolId &symbol) {
+  output << symbol.name();
+  return output;
+}
+
+}  // namespace lisparser
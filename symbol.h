@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+namespace lisparser {
+
+// SymbolId is the interned form of a symbol or keyword name. All the
+// SymbolIds with the same spelling are equal and share one copy of the
+// name, so comparing and hashing them never looks at the characters.
+//
+// Names are interned into a single process-wide table shared by all
+// parsers, which is safe to use from several threads and never shrinks.
+class SymbolId {
+ public:
+  SymbolId() : _name(nullptr) {}
+
+  // Entries are never freed: every distinct name costs memory for the
+  // rest of the process, so parsing untrusted input with unbounded
+  // distinct names grows memory without bound. Services exposed to such
+  // input should watch num_interned() and cap the input or recycle the
+  // process.
+  static SymbolId Intern(std::string_view name);
+
+  // The number of distinct names interned so far.
+  static size_t num_interned();
+
+  inline std::string_view name() const {
+    return _name == nullptr ? std::string_view() : *_name;
+  }
+
+  inline bool operator==(const SymbolId &other) const {
+    return _name == other._name;
+  }
+
+  inline bool operator!=(const SymbolId &other) const {
+    return _name != other._name;
+  }
+
+  inline size_t hash() const {
+    return std::hash<const void*>()(_name);
+  }
+
+ private:
+  explicit SymbolId(const std::string_view *name) : _name(name) {}
+
+  // Points to the entry of the name in the global table.
+  const std::string_view *_name;
+};
+
+std::ostream &operator<<(std::ostream &output, const SymbolId &symbol);
+
+// SymbolCache sits in front of the global table for a single user (e.g.
+// a parser), so that names seen before are resolved without taking the
+// lock of the global table. It is not thread-safe.
+class SymbolCache {
+ public:
+  SymbolCache() : _cache() {}
+
+  SymbolId Intern(std::string_view name) {
+    auto iter = _cache.find(name);
+    if (iter != _cache.end()) return iter->second;
+    SymbolId symbol = SymbolId::Intern(name);
+    // The key has to point to the interned copy of the name, which
+    // outlives the cache.
+    _cache.emplace(symbol.name(), symbol);
+    return symbol;
+  }
+
+ private:
+  std::unordered_map<std::string_view, SymbolId> _cache;
+};
+
+}  // namespace lisparser
+
+namespace std {
+template <>
+struct hash<lisparser::SymbolId> {
+  size_t operator()(const lisparser::SymbolId &symbol) const {
+    return symbol.hash();
+  }
+};
+}  // namespace std
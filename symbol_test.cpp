@@ -0,0 +1,39 @@
+#include "symbol.h"
+
+#include <string>
+#include "gtest/gtest.h"
+
+namespace lisparser {
+
+TEST(SymbolId, InternTest) {
+  std::string name = "a-rather-long-symbol-name";
+  SymbolId first = SymbolId::Intern(name);
+  SymbolId second = SymbolId::Intern(std::string(name));
+
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(name, first.name());
+  EXPECT_NE(name.data(), first.name().data());
+  EXPECT_NE(first, SymbolId::Intern(":a-rather-long-symbol-name"));
+  EXPECT_EQ("", SymbolId().name());
+}
+
+TEST(SymbolId, NumInternedTest) {
+  SymbolId::Intern("num-interned-first");
+  size_t before = SymbolId::num_interned();
+
+  SymbolId::Intern("num-interned-first");
+  EXPECT_EQ(before, SymbolId::num_interned());
+  SymbolId::Intern("num-interned-second");
+  EXPECT_EQ(before + 1, SymbolId::num_interned());
+}
+
+TEST(SymbolCache, InternTest) {
+  SymbolCache cache;
+  std::string name = "abc";
+
+  SymbolId symbol = cache.Intern(name);
+  EXPECT_EQ(SymbolId::Intern("abc"), symbol);
+  EXPECT_EQ(symbol, cache.Intern(name));
+}
+
+}  // namespace lisparser
@@ -1,13 +1,27 @@
 #include "token.h"
 
-#include <cctype>
 #include <iostream>
 #include "util/char_ops.h"
+#include "util/number.h"
 
 namespace lisparser {
 
 std::ostream &operator<<(std::ostream &output,
                          const Token &token) {
+  output << "{" << token.type << ", ";
+  if (token.type == Token::INTEGER) {
+    output << token.integer;
+  } else if (token.type == Token::FLOAT) {
+    output << token.real;
+  } else {
+    output << token.value;
+  }
+  output << "}";
+  return output;
+}
+
+std::ostream &operator<<(std::ostream &output,
+                         const TokenView &token) {
   output << "{" << token.type << ", " << token.value << "}";
   return output;
 }
@@ -21,7 +35,8 @@ template <>
 Token MakeToken<Token::OPEN_PAREN>(std::istream *stream) {
   char character;
 
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   assert(character == '(');
 
   return Token(Token::OPEN_PAREN);
@@ -31,7 +46,8 @@ template <>
 Token MakeToken<Token::CLOSE_PAREN>(std::istream *stream) {
   char character;
 
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   assert(character == ')');
 
   return Token(Token::CLOSE_PAREN);
@@ -41,7 +57,8 @@ template <>
 Token MakeToken<Token::COMMA>(std::istream *stream) {
   char character;
 
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   assert(character == ',');
 
   return Token(Token::COMMA);
@@ -51,13 +68,14 @@ template <>
 Token MakeToken<Token::KEYWORD>(std::istream *stream) {
   char character;
 
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   assert(character == ':');
 
   std::string value = ":";
   while (util::char_ops::SymbolCharacter(stream->peek())) {
     stream->get(character);
-    value.push_back(static_cast<char>(std::tolower(character)));
+    value.push_back(util::char_ops::ToLower(character));
   }
 
   if (value.size() == 1) {
@@ -75,7 +93,7 @@ Token MakeToken<Token::SYMBOL>(std::istream *stream) {
   std::string value;
   while (util::char_ops::SymbolCharacter(stream->peek())) {
     stream->get(character);
-    value.push_back(static_cast<char>(std::tolower(character)));
+    value.push_back(util::char_ops::ToLower(character));
   }
 
   assert(!value.empty());
@@ -87,7 +105,8 @@ template <>
 Token MakeToken<Token::STRING>(std::istream *stream) {
   char character;
 
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   assert(character == '"');
 
   bool escape_sign = false;
@@ -136,30 +155,68 @@ Token MakeToken<Token::STRING>(std::istream *stream) {
 }
 
 
+namespace {
+// Holds the literal of a number being scanned, on the stack unless it is
+// unusually long, since it is only needed to convert floats and to
+// report numbers out of range.
+class NumberLiteral {
+ public:
+  NumberLiteral() : _size(0), _spilled() {}
+
+  void push_back(char character) {
+    if (_size < INLINE_SIZE) {
+      _inline[_size] = character;
+    } else {
+      if (_size == INLINE_SIZE) _spilled.assign(_inline, INLINE_SIZE);
+      _spilled.push_back(character);
+    }
+    ++_size;
+  }
+
+  std::string_view view() const {
+    if (_size <= INLINE_SIZE) return std::string_view(_inline, _size);
+    return _spilled;
+  }
+
+ private:
+  static constexpr size_t INLINE_SIZE = 64;
+
+  char _inline[INLINE_SIZE];
+  size_t _size;
+  std::string _spilled;
+};
+}  // namespace
+
 Token MakeNumberToken(std::istream *stream) {
   char character;
 
   bool dot = false;
+  bool negative = false;
+  // The integer value is accumulated along the way, so that only floats
+  // have to be converted afterwards.
+  uint64_t magnitude = 0;
+  bool in_range = true;
 
-
-
-  std::string value;
+  NumberLiteral literal;
   int peek = stream->peek();
   if (peek == '-') {
     stream->get(character);
-    value.push_back('-');
+    literal.push_back('-');
+    negative = true;
   }
 
   while ((peek = stream->peek()) != EOF) {
-    if (std::isdigit(peek)) {
+    if (util::char_ops::Digit(peek)) {
       stream->get(character);
-      value.push_back(character);
+      literal.push_back(character);
+      in_range = in_range &&
+          util::number::AppendDigit(&magnitude, character - '0');
     } else if (peek == '.') {
       if (dot) return Token(Token::INVALID_TOKEN,
                             "Number with more than one dot.");
       dot = true;
       stream->get(character);
-      value.push_back(character);
+      literal.push_back(character);
     } else if (peek == '-') {
       return Token(Token::INVALID_TOKEN, "Excessive minus sign.");
     } else {
@@ -167,23 +224,35 @@ Token MakeNumberToken(std::istream *stream) {
     }
   }
 
+  std::string_view value = literal.view();
   assert(!value.empty());
 
   if (value.size() == 1 && (value[0] == '.' || value[0] == '-')) {
     return Token(Token::INVALID_TOKEN, "Number with nothing but dot/minus sign.");
   }
 
+  Token token(dot ? Token::FLOAT : Token::INTEGER);
   if (dot) {
-    return Token(Token::FLOAT, std::move(value));
+    std::errc error = util::number::ParseDouble(value, &token.real);
+    if (error == std::errc::invalid_argument) {
+      return Token(Token::INVALID_TOKEN, "Malformed number.");
+    }
+    in_range = error == std::errc();
   } else {
-    return Token(Token::INTEGER, std::move(value));
+    in_range = in_range &&
+        util::number::ToInt64(magnitude, negative, &token.integer);
+  }
+  if (!in_range) {
+    return Token(Token::NUMBER_OUT_OF_RANGE, std::string(value));
   }
+  return token;
 }
 
 template <>
 Token MakeToken<Token::INVALID_TOKEN>(std::istream *stream) {
   char character;
-  assert(stream->get(character));
+  stream->get(character);
+  assert(*stream);
   return Token(Token::INVALID_TOKEN, std::string(1, character));
 }
 
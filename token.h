@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 namespace lisparser {
 
@@ -10,6 +12,8 @@ struct Token {
   enum Type {
     INVALID_TOKEN = 1000,
     TERMINATOR = 1001,
+    // A well formed INTEGER or FLOAT whose value is out of range.
+    NUMBER_OUT_OF_RANGE = 1002,
     OPEN_PAREN = 0,
     CLOSE_PAREN = 1,
     COMMA = 2,
@@ -21,24 +25,77 @@ struct Token {
   };
 
   Token(Type input_type, const std::string &input_value)
-      : type(input_type), value(input_value) {}
+      : type(input_type), value(input_value), integer(0) {}
 
   Token(Type input_type, std::string &&input_value)
-      : type(input_type), value(input_value) {}
+      : type(input_type), value(std::move(input_value)), integer(0) {}
 
   Token(Type input_type)
-      : type(input_type), value() {}
+      : type(input_type), value(), integer(0) {}
+
+  static Token Integer(int64_t value) {
+    Token token(INTEGER);
+    token.integer = value;
+    return token;
+  }
+
+  static Token Float(double value) {
+    Token token(FLOAT);
+    token.real = value;
+    return token;
+  }
 
   inline bool operator==(const Token& other) const {
-    return (type == other.type) && (value == other.value);
+    if (type != other.type || value != other.value) return false;
+    if (type == INTEGER) return integer == other.integer;
+    if (type == FLOAT) return real == other.real;
+    return true;
   }
 
   Type type;
+  // Empty for INTEGER and FLOAT tokens, which only carry their value.
   std::string value;
+  // The value of INTEGER and FLOAT tokens, computed while scanning.
+  union {
+    int64_t integer;
+    double real;
+  };
+};
+
+// TokenView is the zero-copy counterpart of Token, produced by
+// BufferTokenizer. The value points into the source buffer whenever
+// possible. Tokens that have to be rewritten (strings with escapes,
+// symbols and keywords with upper case letters) point into the scratch
+// storage of the tokenizer instead, and are only valid until the next
+// call to Next().
+struct TokenView {
+  TokenView(Token::Type input_type,
+            std::string_view input_value = std::string_view(),
+            size_t input_offset = 0, size_t input_length = 0)
+      : type(input_type), value(input_value),
+        offset(input_offset), length(input_length), integer(0) {}
+
+  // Offset and length are deliberately not compared, so that tests can
+  // write the expected tokens without knowing where they are.
+  inline bool operator==(const TokenView& other) const {
+    return (type == other.type) && (value == other.value);
+  }
+
+  Token::Type type;
+  std::string_view value;
+  // The span of the token in the source buffer.
+  size_t offset;
+  size_t length;
+  // Same as in Token.
+  union {
+    int64_t integer;
+    double real;
+  };
 };
 
 // For debug purpose.
 std::ostream &operator<<(std::ostream &output, const Token &token);
+std::ostream &operator<<(std::ostream &output, const TokenView &token);
 
 // MakeToken is the LL(1) dispatcher functions for those tokens. It is
 // fully specialized for each token type below.
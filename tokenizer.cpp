@@ -1,6 +1,5 @@
 #include "tokenizer.h"
 
-#include <cctype>
 #include "util/char_ops.h"
 
 namespace lisparser {
@@ -50,7 +49,7 @@ Token Tokenizer::Next() {
         return MakeToken<Token::COMMA>(_input_stream.get());
 
       default:
-        if (std::isdigit(peek) || peek == '.' || peek == '-') {
+        if (util::char_ops::Digit(peek) || peek == '.' || peek == '-') {
           return MakeNumberToken(_input_stream.get());
         } else if (util::char_ops::SymbolCharacter(peek)) {
           return MakeToken<Token::SYMBOL>(_input_stream.get());
@@ -15,6 +15,14 @@ class Tokenizer {
       : _input_stream(input) {}
   
   Token Next();
+
+  // The number of characters consumed so far, or 0 if the stream cannot
+  // tell (e.g. a pipe).
+  size_t position() const {
+    std::streampos position = _input_stream->rdbuf()->pubseekoff(
+        0, std::ios::cur, std::ios::in);
+    return position < 0 ? 0 : static_cast<size_t>(position);
+  }
   
  private:
   Tokenizer(const Tokenizer&) = delete;
@@ -1,6 +1,7 @@
 #include "token.h"
 #include "tokenizer.h"
 
+#include <limits>
 #include "gtest/gtest.h"
 
 
@@ -105,9 +106,9 @@ TEST(Tokenizer, SymbolTest) {
 TEST(Tokenizer, NumberTest) {
   Tokenizer tokenizer("(12 (11.52))");
   EXPECT_EQ(Token(Token::OPEN_PAREN), tokenizer.Next());
-  EXPECT_EQ(Token(Token::INTEGER, "12"), tokenizer.Next());
+  EXPECT_EQ(Token::Integer(12), tokenizer.Next());
   EXPECT_EQ(Token(Token::OPEN_PAREN), tokenizer.Next());
-  EXPECT_EQ(Token(Token::FLOAT, "11.52"), tokenizer.Next());
+  EXPECT_EQ(Token::Float(11.52), tokenizer.Next());
   EXPECT_EQ(Token(Token::CLOSE_PAREN), tokenizer.Next());
   EXPECT_EQ(Token(Token::CLOSE_PAREN), tokenizer.Next());
   EXPECT_EQ(Token(Token::TERMINATOR), tokenizer.Next());
@@ -115,11 +116,33 @@ TEST(Tokenizer, NumberTest) {
 
 TEST(Tokenizer, SpecialNumberTest) {
   Tokenizer tokenizer(".23 -15 a-b (-.88");
-  EXPECT_EQ(Token(Token::FLOAT, ".23"), tokenizer.Next());
-  EXPECT_EQ(Token(Token::INTEGER, "-15"), tokenizer.Next());
+  EXPECT_EQ(Token::Float(.23), tokenizer.Next());
+  EXPECT_EQ(Token::Integer(-15), tokenizer.Next());
   EXPECT_EQ(Token(Token::SYMBOL, "a-b"), tokenizer.Next());
   EXPECT_EQ(Token(Token::OPEN_PAREN), tokenizer.Next());
-  EXPECT_EQ(Token(Token::FLOAT, "-.88"), tokenizer.Next());
+  EXPECT_EQ(Token::Float(-.88), tokenizer.Next());
+}
+
+TEST(Tokenizer, NumberValueTest) {
+  Tokenizer tokenizer("12 -0.25 .5 9223372036854775807 -9223372036854775808");
+  EXPECT_EQ(12, tokenizer.Next().integer);
+  EXPECT_EQ(-0.25, tokenizer.Next().real);
+  EXPECT_EQ(0.5, tokenizer.Next().real);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), tokenizer.Next().integer);
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(), tokenizer.Next().integer);
+}
+
+TEST(Tokenizer, NumberOutOfRangeTest) {
+  Tokenizer tokenizer("9223372036854775808 -9223372036854775809 "
+                      "99999999999999999999999 " + std::string(400, '9') +
+                      ".5 1.5");
+  EXPECT_EQ(Token(Token::NUMBER_OUT_OF_RANGE, "9223372036854775808"),
+            tokenizer.Next());
+  EXPECT_EQ(Token(Token::NUMBER_OUT_OF_RANGE, "-9223372036854775809"),
+            tokenizer.Next());
+  EXPECT_EQ(Token::NUMBER_OUT_OF_RANGE, tokenizer.Next().type);
+  EXPECT_EQ(Token::NUMBER_OUT_OF_RANGE, tokenizer.Next().type);
+  EXPECT_EQ(Token::Float(1.5), tokenizer.Next());
 }
 
 TEST(Tokenizer, NumberFailureTest) {
@@ -143,6 +166,14 @@ TEST(Tokenizer, NumberFailureTest) {
     Tokenizer tokenizer("-..");
     EXPECT_EQ(Token::INVALID_TOKEN, tokenizer.Next().type);
   }
+
+  {
+    // Malformed rather than out of range.
+    Tokenizer tokenizer("-. -.5");
+    EXPECT_EQ(Token(Token::INVALID_TOKEN, "Malformed number."),
+              tokenizer.Next());
+    EXPECT_EQ(Token::Float(-.5), tokenizer.Next());
+  }
 }
 
 TEST(Tokenizer, CommentTest) {
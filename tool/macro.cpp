@@ -1,11 +1,18 @@
+#include <algorithm>
 #include <functional>
 #include <utility>
 #include "tool/macro.h"
+#include "util/parallel_for.h"
 
 namespace lisparser {
 namespace macro {
 
 namespace {
+// Forms are handed out to the threads in batches, so that small forms do
+// not all contend for the counter of the pool, with enough batches per
+// thread that a few slow ones do not leave the other threads idle.
+constexpr size_t BATCHES_PER_THREAD = 64;
+
 util::Result<ArgumentMap> AcquireArgumentMap(AST &&args) {
   if (args.type() != AST::LIST) {
     return util::Result<ArgumentMap>(
@@ -13,7 +20,7 @@ util::Result<ArgumentMap> AcquireArgumentMap(AST &&args) {
         "macro arguments should be a list");
   }
 
-  std::vector<AST> arg_list = args.ReleaseVector();
+  AST::List arg_list = args.ReleaseVector();
   ArgumentMap argument_id;
   size_t current_id = 1;
   for (const AST &arg : arg_list) {
@@ -23,53 +30,181 @@ util::Result<ArgumentMap> AcquireArgumentMap(AST &&args) {
           util::StrCat(arg, " is not a valid macro argument"));
     }
 
-    if (argument_id.count(arg.AsString()) > 0) {
+    if (argument_id.count(arg.AsSymbol()) > 0) {
       return util::Result<ArgumentMap>(
           INVALID_MACRO_ARGS,
           util::StrCat("duplicate argument '",
                        arg, "'"));
     }
 
-    argument_id[arg.AsString()] = current_id;
+    argument_id[arg.AsSymbol()] = current_id;
     ++current_id;
   }
 
-  return std::move(argument_id);
+  return argument_id;
 }
 
-util::Result<bool> CheckBody(const ArgumentMap &argument_id,
-                             const AST &body) {
-  if (body.type() == AST::EVAL_FORM) {
-    if (argument_id.count(body.AsString()) == 0) {
+// Appends the instructions that build the node to the template.
+util::Result<bool> Compile(const ArgumentMap &argument_id, AST &&node,
+                           MacroTemplate *output) {
+  if (node.type() == AST::EVAL_FORM) {
+    auto iter = argument_id.find(node.AsSymbol());
+    if (iter == argument_id.end()) {
       return util::Result<bool>(
           INVALID_MACRO_FORM,
-          util::StrCat("'", body, "' is not in the lambda list"));
+          util::StrCat("'", node, "' is not in the lambda list"));
     }
-  } else if (body.type() == AST::LIST) {
-    for (const AST &sub : body.AsVector()) {
-      auto result = CheckBody(argument_id, sub);
-      if (!result.ok()) {
-        return result;
-      }
+    output->code.push_back({MacroTemplate::ARGUMENT, false,
+                            static_cast<uint32_t>(iter->second)});
+    ++output->uses[iter->second];
+    return true;
+  }
+
+  if (node.type() != AST::LIST) {
+    output->code.push_back(
+        {MacroTemplate::CONSTANT, false,
+         static_cast<uint32_t>(output->constants.size())});
+    output->constants.push_back(std::move(node));
+    return true;
+  }
+
+  AST::List children = node.ReleaseVector();
+  size_t list_code = output->code.size();
+  size_t first_constant = output->constants.size();
+  output->code.push_back({MacroTemplate::LIST, false,
+                          static_cast<uint32_t>(children.size())});
+  for (AST &child : children) {
+    auto result = Compile(argument_id, std::move(child), output);
+    if (!result.ok()) return result;
+  }
+
+  // When all the children turned out to be constants, so is the list.
+  if (output->code.size() - list_code - 1 == children.size()) {
+    for (size_t i = list_code + 1; i < output->code.size(); ++i) {
+      if (output->code[i].operation != MacroTemplate::CONSTANT) return true;
+    }
+
+    AST list = AST::Vector();
+    for (size_t i = first_constant; i < output->constants.size(); ++i) {
+      list.Push(std::move(output->constants[i]));
     }
+    output->constants.erase(output->constants.begin() + first_constant,
+                            output->constants.end());
+    output->code.resize(list_code);
+    output->code.push_back(
+        {MacroTemplate::CONSTANT, false,
+         static_cast<uint32_t>(output->constants.size())});
+    output->constants.push_back(std::move(list));
   }
 
   return true;
 }
-}  // namespace
 
-util::Result<bool> Engine::Acquire(AST &&macro_ast) {
+// Marks the last slot of every argument.
+void MarkLastSlots(MacroTemplate *body) {
+  std::vector<bool> seen(body->uses.size(), false);
+  for (auto iter = body->code.rbegin(); iter != body->code.rend(); ++iter) {
+    if (iter->operation == MacroTemplate::ARGUMENT && !seen[iter->operand]) {
+      iter->last = true;
+      seen[iter->operand] = true;
+    }
+  }
+}
+
+// Builds the body of the macro, with the arguments taken from the macro
+// form, which is left in an unspecified state.
+AST Instantiate(const MacroTemplate &body, AST::List &&macro_form) {
+  // The lists being built, innermost last, with the number of children
+  // they still miss.
+  std::vector<std::pair<AST, uint32_t>> stack;
+
+  for (const MacroTemplate::Instruction &instruction : body.code) {
+    AST node = AST::Integer(0);
+    switch (instruction.operation) {
+      case MacroTemplate::CONSTANT:
+        node = body.constants[instruction.operand].Copy();
+        break;
+
+      case MacroTemplate::ARGUMENT:
+        if (instruction.last) {
+          node = std::move(macro_form[instruction.operand]);
+        } else {
+          node = macro_form[instruction.operand].Copy();
+        }
+        break;
+
+      case MacroTemplate::LIST:
+        if (instruction.operand > 0) {
+          stack.emplace_back(AST::Vector(), instruction.operand);
+          stack.back().first.Reserve(instruction.operand);
+          continue;
+        }
+        node = AST::Vector();
+        break;
+    }
+
+    do {
+      if (stack.empty()) return node;
+      stack.back().first.Push(std::move(node));
+      if (--stack.back().second > 0) break;
+      node = std::move(stack.back().first);
+      stack.pop_back();
+    } while (true);
+  }
+
+  // Unreachable, since the code builds exactly one node.
+  assert(false);
+  return AST::Vector();
+}
+
+// Same as above on hash-consed trees.
+SharedAST Instantiate(const MacroTemplate &body,
+                      const std::vector<SharedAST> &macro_form,
+                      SharedAstPool *pool) {
+  std::vector<std::pair<std::vector<SharedAST>, uint32_t>> stack;
+
+  for (const MacroTemplate::Instruction &instruction : body.code) {
+    if (instruction.operation == MacroTemplate::LIST &&
+        instruction.operand > 0) {
+      stack.emplace_back(std::vector<SharedAST>(), instruction.operand);
+      stack.back().first.reserve(instruction.operand);
+      continue;
+    }
+
+    SharedAST node =
+        instruction.operation == MacroTemplate::CONSTANT ?
+        pool->FromAST(body.constants[instruction.operand]) :
+        instruction.operation == MacroTemplate::ARGUMENT ?
+        macro_form[instruction.operand] : pool->List({});
+
+    do {
+      if (stack.empty()) return node;
+      stack.back().first.push_back(std::move(node));
+      if (--stack.back().second > 0) break;
+      node = pool->List(std::move(stack.back().first));
+      stack.pop_back();
+    } while (true);
+  }
+
+  // Unreachable, since the code builds exactly one node.
+  assert(false);
+  return pool->List({});
+}
+// Compiles the macro that the defmacro form defines, and adds it to the
+// table unless there is one with the same name already.
+util::Result<bool> Define(AST &&macro_ast, MacroTable *table) {
   if (macro_ast.type() != AST::LIST) {
     return util::Result<bool>(INVALID_MACRO_FORM,
                               "macro defintion should be in list form");
   }
 
-  if (!(macro_ast.car() == AST::Symbol("defmacro"))) {
+  static const AST defmacro = AST::Symbol("defmacro");
+  if (macro_ast.AsVector().empty() || !(macro_ast.car() == defmacro)) {
     return util::Result<bool>(INVALID_MACRO_FORM,
                               "macro definition should start with 'defmacro'");
   }
   
-  std::vector<AST> form = macro_ast.ReleaseVector();
+  AST::List form = macro_ast.ReleaseVector();
 
   if (form.size() != 4) {
     return util::Result<bool>(INVALID_MACRO_FORM,
@@ -81,9 +216,9 @@ util::Result<bool> Engine::Acquire(AST &&macro_ast) {
                               "macro name should be a keyword");
   }
 
-  std::string name = form[1].AsString();
-  auto error_message = [&name](const std::string &message) {
-    return message + " in macro [" + name + "]";
+  SymbolId name = form[1].AsSymbol();
+  auto error_message = [&name](std::string_view message) {
+    return util::StrCat(message, " in macro [", name, "]");
   };
   
   auto argument_id_result = AcquireArgumentMap(std::move(form[2]));
@@ -92,82 +227,178 @@ util::Result<bool> Engine::Acquire(AST &&macro_ast) {
         argument_id_result.error_code(),
         error_message(argument_id_result.error_message()));
   }
-  ArgumentMap argument_id = *argument_id_result.value();
+  ArgumentMap argument_id = std::move(argument_id_result.value());
 
-  auto result = CheckBody(argument_id, form[3]);
+  MacroTemplate body;
+  body.uses.resize(argument_id.size() + 1);
+  auto result = Compile(argument_id, std::move(form[3]), &body);
   if (!result.ok()) {
     return util::Result<bool>(
         INVALID_MACRO_FORM,
         error_message(result.error_message()));
   }
+  MarkLastSlots(&body);
   
-  _macros.emplace(std::piecewise_construct,
-                  std::forward_as_tuple(name),
-                  std::forward_as_tuple(
-                      std::move(argument_id), std::move(form[3])));
+  table->heads |= AST::HeadBit(name);
+  table->macros.emplace(
+      name, std::make_shared<const Macro>(argument_id.size(),
+                                          std::move(body)));
 
   return true;
 }
 
-util::Result<AST> Engine::Evaluate(const AST &original) {
-  if (original.type() == AST::LIST) {
-    AST new_form = AST::Vector();
-    for (const AST &element : original.AsVector()) {
-      auto evaluated = Evaluate(element);
+util::Result<AST> Evaluate(const MacroTable &table, AST &&original) {
+  if ((original.heads() & table.heads) == 0) return std::move(original);
 
-      if (!evaluated.ok()) {
-        return evaluated;
-      }
-      
-      new_form.Push(std::move(*evaluated.value()));
-    }
+  AST::List &elements = *original.MutableVector();
+  for (AST &element : elements) {
+    if (element.type() != AST::LIST) continue;
+    auto evaluated = Evaluate(table, std::move(element));
+    if (!evaluated.ok()) return evaluated;
+    element = std::move(evaluated).value();
+  }
+  original.RecomputeHeads();
 
-    if (new_form.car().type() == AST::KEYWORD) {
-      auto macro = _macros.find(new_form.car().AsString());
-      if (macro != _macros.end()) {
-        if (macro->second.argument_id.size() + 1 !=
-            new_form.AsVector().size()) {
-          return util::Result<AST>(
-              SIGNATURE_MISMATCH,
-              util::StrCat(macro->first, " wanted ",
-                           macro->second.argument_id.size(),
-                           " arguments, but ",
-                           new_form.AsVector().size() - 1,
-                           " provided"));
-        }
-            
-        auto result = Evaluate(Expand(macro->second.body,
-                                      macro->second.argument_id,
-                                      new_form));
-        if (!result.ok()) return result;
-        return result;
+  if (elements.empty() || elements[0].type() != AST::KEYWORD) {
+    return std::move(original);
+  }
+
+  auto macro = table.macros.find(elements[0].AsSymbol());
+  if (macro == table.macros.end()) return std::move(original);
+
+  if (macro->second->num_arguments + 1 != elements.size()) {
+    return util::Result<AST>(
+        SIGNATURE_MISMATCH,
+        util::StrCat(macro->first, " wanted ",
+                     macro->second->num_arguments,
+                     " arguments, but ",
+                     elements.size() - 1,
+                     " provided"));
+  }
+
+  return Evaluate(table, Instantiate(macro->second->body,
+                                     original.ReleaseVector()));
+}
+
+// Same as above on hash-consed trees, remembering the result of every
+// subtree in evaluated.
+util::Result<SharedAST> Evaluate(
+    const MacroTable &table, const SharedAST &original, SharedAstPool *pool,
+    std::unordered_map<SharedAST, SharedAST> *evaluated) {
+  if ((original.heads() & table.heads) == 0) return SharedAST(original);
+
+  auto known = evaluated->find(original);
+  if (known != evaluated->end()) return SharedAST(known->second);
+
+  std::vector<SharedAST> new_form;
+  new_form.reserve(original.AsVector().size());
+  for (const SharedAST &element : original.AsVector()) {
+    auto result = Evaluate(table, element, pool, evaluated);
+    if (!result.ok()) return result;
+    new_form.push_back(std::move(result.value()));
+  }
+
+  if (!new_form.empty() && new_form[0].type() == AST::KEYWORD) {
+    auto macro = table.macros.find(new_form[0].AsSymbol());
+    if (macro != table.macros.end()) {
+      if (macro->second->num_arguments + 1 != new_form.size()) {
+        return util::Result<SharedAST>(
+            SIGNATURE_MISMATCH,
+            util::StrCat(macro->first, " wanted ",
+                         macro->second->num_arguments,
+                         " arguments, but ",
+                         new_form.size() - 1,
+                         " provided"));
       }
+
+      auto result = Evaluate(
+          table, Instantiate(macro->second->body, new_form, pool),
+          pool, evaluated);
+      if (result.ok()) evaluated->emplace(original, result.value());
+      return result;
     }
-    
-    return std::move(new_form);
-  } 
-
-  return original.Copy();
-}
-
-
-AST Engine::Expand(const AST &body,
-                   const ArgumentMap &argument_id,
-                   const AST &macro_form) {
-  if (body.type() == AST::EVAL_FORM) {
-    auto iter = argument_id.find(body.AsString());
-    assert(iter != argument_id.end());
-    assert(macro_form.AsVector().size() > iter->second);
-    return macro_form.AsVector()[iter->second].Copy();
-  } else if (body.type() == AST::LIST) {
-    AST result = AST::Vector();
-    for (const AST &sub : body.AsVector()) {
-      result.Push(Expand(sub, argument_id, macro_form));
-    }
-    return result;
   }
-  
-  return body.Copy();
+
+  SharedAST result = pool->List(std::move(new_form));
+  evaluated->emplace(original, result);
+  return result;
+}
+}  // namespace
+
+util::Result<bool> Engine::Acquire(AST &&macro_ast) {
+  std::vector<AST> macro_asts;
+  macro_asts.push_back(std::move(macro_ast));
+  return Acquire(std::move(macro_asts));
+}
+
+util::Result<bool> Engine::Acquire(std::vector<AST> &&macro_asts) {
+  std::lock_guard<std::mutex> lock(_writer);
+  auto next = std::make_shared<MacroTable>(*_table.Read());
+  for (AST &macro_ast : macro_asts) {
+    auto result = Define(std::move(macro_ast), next.get());
+    if (!result.ok()) return result;
+  }
+  _table.Publish(std::move(next));
+  return true;
+}
+
+util::Result<bool> Engine::Reload(std::vector<AST> &&macro_asts) {
+  auto next = std::make_shared<MacroTable>();
+  for (AST &macro_ast : macro_asts) {
+    auto result = Define(std::move(macro_ast), next.get());
+    if (!result.ok()) return result;
+  }
+
+  std::lock_guard<std::mutex> lock(_writer);
+  _table.Publish(std::move(next));
+  return true;
+}
+
+util::Result<AST> Engine::Evaluate(const AST &original) const {
+  return Evaluate(original.Copy());
+}
+
+util::Result<AST> Engine::Evaluate(AST &&original) const {
+  return macro::Evaluate(*_table.Read(), std::move(original));
+}
+
+std::vector<util::Result<AST>> Engine::EvaluateAll(
+    std::vector<AST> &&forms, size_t num_threads) const {
+  std::vector<util::Result<AST>> results;
+  results.reserve(forms.size());
+  for (size_t i = 0; i < forms.size(); ++i) {
+    // Placeholders, overwritten below.
+    results.emplace_back(AST::Integer(0));
+  }
+
+  auto pinned = _table.Read();
+  num_threads = std::max<size_t>(num_threads, 1);
+  size_t batch_size = std::max<size_t>(
+      1, forms.size() / (num_threads * BATCHES_PER_THREAD));
+  size_t num_batches = (forms.size() + batch_size - 1) / batch_size;
+  util::ParallelFor(
+      num_batches, num_threads,
+      [&pinned, batch_size, &forms, &results](size_t batch) {
+        size_t end = std::min(forms.size(), (batch + 1) * batch_size);
+        for (size_t i = batch * batch_size; i < end; ++i) {
+          results[i] = macro::Evaluate(*pinned, std::move(forms[i]));
+        }
+      });
+
+  forms.clear();
+  return results;
+}
+
+util::Result<SharedAST> Engine::Evaluate(const SharedAST &original,
+                                         SharedAstPool *pool) const {
+  std::unordered_map<SharedAST, SharedAST> evaluated;
+  return macro::Evaluate(*_table.Read(), original, pool, &evaluated);
+}
+
+std::shared_ptr<const Macro> Engine::Find(SymbolId name) const {
+  auto pinned = _table.Read();
+  auto iter = pinned->macros.find(name);
+  return iter == pinned->macros.end() ? nullptr : iter->second;
 }
 
 }  // namespace macro
@@ -3,16 +3,21 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "ast.h"
+#include "shared_ast.h"
+#include "symbol.h"
+#include "util/published.h"
 #include "util/result.h"
 
 namespace lisparser {
 namespace macro {
 
-using ArgumentMap = std::unordered_map<std::string, size_t>;
+using ArgumentMap = std::unordered_map<SymbolId, size_t>;
 
 enum MacroError {
   INVALID_MACRO_ARGS = 1,
@@ -23,34 +28,139 @@ enum MacroEvaluateError {
   SIGNATURE_MISMATCH = 1,
 };
 
+// MacroTemplate is the body of a macro compiled by Engine::Acquire(),
+// so that expanding it neither walks through its constant parts nor
+// looks up the arguments by name.
+struct MacroTemplate {
+  enum Operation : uint8_t {
+    // Copies constants[operand], a subtree without any eval form.
+    CONSTANT = 0,
+    // A substitution slot, for the argument at position operand of the
+    // macro form (1 for the first argument).
+    ARGUMENT = 1,
+    // Starts a list whose operand children are built by the following
+    // instructions.
+    LIST = 2,
+  };
+
+  struct Instruction {
+    Operation operation;
+    // Whether this is the last slot of the argument, which can take it
+    // over instead of copying it.
+    bool last;
+    uint32_t operand;
+  };
+
+  MacroTemplate() : code(), constants(), uses() {}
+
+  // The instructions that build the body, in pre-order.
+  std::vector<Instruction> code;
+  // The largest subtrees of the body without eval forms.
+  std::vector<AST> constants;
+  // The number of slots of every argument, by position.
+  std::vector<uint32_t> uses;
+};
+
 struct Macro {
-  Macro(ArgumentMap &&input_argument_id,
-        AST &&input_body) :
-      argument_id(std::move(input_argument_id)),
+  Macro(size_t input_num_arguments, MacroTemplate &&input_body) :
+      num_arguments(input_num_arguments),
       body(std::move(input_body)) {}
   
-  ArgumentMap argument_id;
-  AST body;
+  size_t num_arguments;
+  MacroTemplate body;
 };
 
+// MacroTable is a snapshot of the macros of an Engine, which never
+// changes once it is published. The macros are shared by the snapshots
+// that contain them, so that making a new snapshot only copies pointers.
+struct MacroTable {
+  MacroTable() : macros(), heads(0) {}
+
+  std::unordered_map<SymbolId, std::shared_ptr<const Macro>> macros;
+  // The names of all the macros.
+  AST::HeadSet heads;
+};
+
+// Engine expands the macros it has acquired, and can be used from any
+// number of threads. Every evaluation reads the current MacroTable
+// through a util::Published, so it takes no lock, bumps no shared
+// reference count and never waits for a writer. Acquire() and Reload()
+// build a new table on the side and then publish it in one atomic step,
+// so evaluations that are running when it happens finish with the
+// macros they started with. Writers then wait for those evaluations
+// before freeing the old table.
 class Engine {
  public:
-  Engine() : _macros() {}
+  Engine() : _table(std::make_shared<const MacroTable>()), _writer() {}
 
+  // Adds the macro defined by the defmacro form. A macro that is already
+  // defined is kept. Every call copies the table of the macros, so
+  // adding many macros one at a time takes quadratic time: use the
+  // overload below or Reload() instead.
   util::Result<bool> Acquire(AST &&macro_ast);
 
-  util::Result<AST> Evaluate(const AST &original);
+  // Adds the macros the defmacro forms define, copying the table once.
+  // If any of the forms is invalid, its error is returned and the macros
+  // stay as they were.
+  util::Result<bool> Acquire(std::vector<AST> &&macro_asts);
+
+  // Replaces all the macros by the ones the defmacro forms define. If any
+  // of the forms is invalid, its error is returned and the macros stay as
+  // they were.
+  util::Result<bool> Reload(std::vector<AST> &&macro_asts);
+
+  // Returns a new tree, so the whole form is copied first, which takes
+  // time linear in its size, and the copy is evaluated as below. Prefer
+  // the overload below when the form is not needed afterwards.
+  util::Result<AST> Evaluate(const AST &original) const;
+
+  // Takes over the form and rewrites it in place. Subtrees whose
+  // AST::heads() share no keyword with the names of the macros contain
+  // no macro call, and are returned as they are without being visited,
+  // so the work grows with the number of macro calls rather than with
+  // the size of the form. The arguments of a macro call are moved into
+  // their last slot of the macro body, and only copied into the other
+  // ones.
+  util::Result<AST> Evaluate(AST &&original) const;
+
+  // Evaluates every form as above with util::ParallelFor: up to
+  // num_threads threads, started for this call and joined before it
+  // returns, claim batches of forms from a shared atomic counter until
+  // none is left. There is no persistent pool and no work stealing. The
+  // results, and the errors of the forms that fail, are returned in the
+  // order of the forms. All the forms see the same snapshot of the
+  // macros.
+  std::vector<util::Result<AST>> EvaluateAll(std::vector<AST> &&forms,
+                                             size_t num_threads) const;
+
+  // Evaluates a hash-consed tree, whose new nodes are created in the
+  // pool. The arguments are substituted without copying them, and every
+  // distinct subtree is evaluated once, however many times it occurs.
+  util::Result<SharedAST> Evaluate(const SharedAST &original,
+                                   SharedAstPool *pool) const;
+
+  // The current snapshot of the macros, which stays valid as long as it
+  // is held. Unlike evaluating, this bumps the reference count of the
+  // table.
+  inline std::shared_ptr<const MacroTable> table() const {
+    return _table.Read().Share();
+  }
 
   inline size_t size() const {
-    return _macros.size();
+    return _table.Read()->macros.size();
   }
-  
+
+  // Returns nullptr if there is no macro with that name.
+  std::shared_ptr<const Macro> Find(SymbolId name) const;
+
  private:
-  AST Expand(const AST &body,
-             const ArgumentMap &argument_id,
-             const AST &macro_form);
+  Engine(const Engine&) = delete;
+  const Engine &operator=(const Engine&) = delete;
 
-  std::unordered_map<std::string, Macro> _macros;
+  util::Published<MacroTable> _table;
+  // Serializes the writers, so that none of them misses the macros
+  // another one adds.
+  std::mutex _writer;
 };
 
 }  // namespace macro
@@ -1,6 +1,10 @@
 #include "tool/macro.h"
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "gtest/gtest.h"
 #include "parser.h"
 
@@ -9,7 +13,7 @@ namespace macro {
 
 AST ParseOrDie(const std::string &code) {
   Parser parser(code);
-  return std::move(*parser.Next().value());
+  return parser.Next().value();
 }
 
 TEST(Macro, AcquireTest) {
@@ -38,7 +42,7 @@ TEST(Macro, SimpleEvalTest) {
       "  (+ ,a ,b))")).ok());
 
   EXPECT_EQ(ParseOrDie("(+ (+ 12 13) (+ 11.5 11.6))"),
-            *engine.Evaluate(
+            engine.Evaluate(
                 ParseOrDie("(:plus (:plus 12 13) "
                            "       (:plus 11.5 11.6))")).value());
 }
@@ -51,7 +55,7 @@ TEST(Macro, NoArgumentEvalTest) {
       "(defmacro :laugh () \"haha\")")).ok());
 
   EXPECT_EQ(ParseOrDie("(i say \"haha\")"),
-            *engine.Evaluate(
+            engine.Evaluate(
                 ParseOrDie("(I say (:laugh))")).value());
 }
 
@@ -69,7 +73,7 @@ TEST(Macro, HierarchicalMacroTest) {
   
   EXPECT_EQ(
       ParseOrDie("(the result is (+ 1 (+ 2 (+ 3 (+ 4 5)))))"),
-      *engine.Evaluate(
+      engine.Evaluate(
           ParseOrDie("(the result is "
                      "  (:multi-plus 1 2 3 (:plus 4 5)))")).value());
 }
@@ -194,5 +198,317 @@ TEST(Macro, EvaluateFailureSignatureMismatch) {
             result.error_message());
 }
 
+TEST(Macro, TemplateTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :m (a b) (let ((x 1) (y \"s\")) (+ ,a ,b ,a)))")).ok());
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :constant (a) (list (1 2) \"s\"))")).ok());
+
+  std::shared_ptr<const Macro> macro =
+      engine.Find(AST::Keyword(":m").AsSymbol());
+  ASSERT_NE(nullptr, macro);
+  EXPECT_EQ(2, macro->num_arguments);
+
+  // (let <constant> (+ ,a ,b ,a))
+  using Template = MacroTemplate;
+  std::vector<std::pair<Template::Operation, uint32_t>> code;
+  for (const Template::Instruction &instruction : macro->body.code) {
+    code.emplace_back(instruction.operation, instruction.operand);
+  }
+  EXPECT_EQ((std::vector<std::pair<Template::Operation, uint32_t>>({
+        {Template::LIST, 3}, {Template::CONSTANT, 0},
+        {Template::CONSTANT, 1}, {Template::LIST, 4},
+        {Template::CONSTANT, 2}, {Template::ARGUMENT, 1},
+        {Template::ARGUMENT, 2}, {Template::ARGUMENT, 1}})),
+    code);
+  EXPECT_EQ(ParseOrDie("((x 1) (y \"s\"))"), macro->body.constants[1]);
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 1}), macro->body.uses);
+
+  EXPECT_EQ(ParseOrDie("(let ((x 1) (y \"s\")) (+ (f) 2 (f)))"),
+            engine.Evaluate(ParseOrDie("(:m (f) 2)")).value());
+
+  macro = engine.Find(AST::Keyword(":constant").AsSymbol());
+  ASSERT_NE(nullptr, macro);
+  ASSERT_EQ(1, macro->body.code.size());
+  EXPECT_EQ(Template::CONSTANT, macro->body.code[0].operation);
+  EXPECT_EQ(ParseOrDie("(list (1 2) \"s\")"),
+            engine.Evaluate(ParseOrDie("(:constant 3)")).value());
+
+  EXPECT_EQ(nullptr, engine.Find(AST::Keyword(":none").AsSymbol()));
+}
+
+TEST(Macro, MoveEvalTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :once (a b) (f ,a ,b))")).ok());
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :twice (a) (g ,a ,a))")).ok());
+
+  // Long strings live out of line, so their addresses tell whether
+  // they have been moved or copied.
+  std::string text = "a string longer than the inline capacity";
+  {
+    AST form = ParseOrDie("(a (b \"" + text + "\") :c)");
+    const char *address = form.AsVector()[1].AsVector()[1].AsString().data();
+    auto result = engine.Evaluate(std::move(form));
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(address,
+              result.value().AsVector()[1].AsVector()[1].AsString().data());
+  }
+  {
+    AST form = ParseOrDie("(x (:once \"" + text + "\" 2))");
+    const char *address = form.AsVector()[1].AsVector()[1].AsString().data();
+    auto result = engine.Evaluate(std::move(form));
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(ParseOrDie("(x (f \"" + text + "\" 2))"), result.value());
+    EXPECT_EQ(address,
+              result.value().AsVector()[1].AsVector()[1].AsString().data());
+  }
+  {
+    AST form = ParseOrDie("(:twice \"" + text + "\")");
+    const char *address = form.AsVector()[1].AsString().data();
+    auto result = engine.Evaluate(std::move(form));
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(ParseOrDie("(g \"" + text + "\" \"" + text + "\")"),
+              result.value());
+    // Copied into the first slot, and moved into the last one.
+    EXPECT_NE(address, result.value().AsVector()[1].AsString().data());
+    EXPECT_EQ(address, result.value().AsVector()[2].AsString().data());
+  }
+
+  EXPECT_EQ(SIGNATURE_MISMATCH,
+            engine.Evaluate(ParseOrDie("(a (:once 1))")).error_code());
+}
+
+TEST(Macro, SkipTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :m (a) (f ,a))")).ok());
+
+  // Nothing in a subtree without a call to a known macro is visited, so
+  // it keeps its exact heads.
+  AST form = ParseOrDie("(a (:other (b c)) (d (e)))");
+  AST::HeadSet heads = form.heads();
+  ASSERT_NE(0, heads);
+  auto result = engine.Evaluate(std::move(form));
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(heads, result.value().heads());
+  EXPECT_EQ(ParseOrDie("(a (:other (b c)) (d (e)))"), result.value());
+
+  result = engine.Evaluate(ParseOrDie("(a (b c) (d (:m (:m 1))))"));
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(ParseOrDie("(a (b c) (d (f (f 1))))"), result.value());
+  // The untouched sibling is still summarized.
+  EXPECT_EQ(0, result.value().AsVector()[1].heads());
+
+  SharedAstPool pool;
+  SharedAST shared = pool.FromAST(ParseOrDie("(a (:other (b c)))"));
+  auto shared_result = engine.Evaluate(shared, &pool);
+  ASSERT_TRUE(shared_result.ok());
+  EXPECT_EQ(shared, shared_result.value());
+}
+
+TEST(Macro, EvaluatedHeadsTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :plus (a b) (:add ,a ,b))")).ok());
+
+  // Both the rewritten lists and the untouched ones keep exact heads.
+  std::vector<std::pair<const char*, const char*>> cases = {
+    {"(f (:plus 1 (:plus 2 3)) (g (:h x)))",
+     "(f (:add 1 (:add 2 3)) (g (:h x)))"},
+    {"(f (g (:h x)))", "(f (g (:h x)))"},
+    {"(:plus (:keep 1) 2)", "(:add (:keep 1) 2)"},
+  };
+  for (const auto &[code, expected] : cases) {
+    auto result = engine.Evaluate(ParseOrDie(code));
+    ASSERT_TRUE(result.ok());
+    AST parsed = ParseOrDie(expected);
+    EXPECT_EQ(parsed, result.value());
+    EXPECT_EQ(parsed.heads(), result.value().heads()) << code;
+    EXPECT_EQ(parsed.AsVector().back().heads(),
+              result.value().AsVector().back().heads()) << code;
+  }
+}
+
+TEST(Macro, EvaluateAllTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :pair (a b) (list ,a ,b))")).ok());
+
+  std::vector<std::string> codes;
+  for (int i = 0; i < 1000; ++i) {
+    std::string number = std::to_string(i);
+    if (i % 7 == 3) {
+      codes.push_back("(f (:pair " + number + "))");
+    } else {
+      codes.push_back("(f (:pair " + number + " (:pair x " + number + ")))");
+    }
+  }
+
+  for (size_t num_threads : {1, 4}) {
+    std::vector<AST> forms;
+    for (const std::string &code : codes) {
+      forms.push_back(ParseOrDie(code));
+    }
+
+    std::vector<util::Result<AST>> results =
+        engine.EvaluateAll(std::move(forms), num_threads);
+    ASSERT_EQ(codes.size(), results.size());
+    for (size_t i = 0; i < codes.size(); ++i) {
+      auto expected = engine.Evaluate(ParseOrDie(codes[i]));
+      ASSERT_EQ(expected.ok(), results[i].ok()) << codes[i];
+      if (expected.ok()) {
+        EXPECT_EQ(expected.value(), results[i].value());
+      } else {
+        EXPECT_EQ(expected.error_code(), results[i].error_code());
+        EXPECT_EQ(expected.error_message(), results[i].error_message());
+      }
+    }
+  }
+
+  EXPECT_TRUE(engine.EvaluateAll({}, 4).empty());
+}
+
+TEST(Macro, AcquireManyTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie("(defmacro :m (a) (m ,a))")).ok());
+
+  std::vector<AST> macros;
+  macros.push_back(ParseOrDie("(defmacro :m (a) (other ,a))"));
+  macros.push_back(ParseOrDie("(defmacro :n () (n))"));
+  EXPECT_TRUE(engine.Acquire(std::move(macros)).ok());
+  EXPECT_EQ(2, engine.size());
+  // The macros that are already defined are kept.
+  EXPECT_EQ(ParseOrDie("(m (n))"),
+            engine.Evaluate(ParseOrDie("(:m (:n))")).value());
+
+  // An invalid form changes nothing.
+  macros.clear();
+  macros.push_back(ParseOrDie("(defmacro :o () (o))"));
+  macros.push_back(ParseOrDie("(defmacro :bad (a) (f ,b))"));
+  EXPECT_EQ(INVALID_MACRO_FORM,
+            engine.Acquire(std::move(macros)).error_code());
+  EXPECT_EQ(2, engine.size());
+  EXPECT_EQ(nullptr, engine.Find(AST::Keyword(":o").AsSymbol()));
+}
+
+TEST(Macro, ReloadTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :m (a) (old ,a))")).ok());
+  std::shared_ptr<const MacroTable> pinned = engine.table();
+
+  std::vector<AST> library;
+  library.push_back(ParseOrDie("(defmacro :m (a) (new ,a))"));
+  library.push_back(ParseOrDie("(defmacro :n () (n))"));
+  EXPECT_TRUE(engine.Reload(std::move(library)).ok());
+  EXPECT_EQ(2, engine.size());
+  EXPECT_EQ(ParseOrDie("(new 1)"),
+            engine.Evaluate(ParseOrDie("(:m 1)")).value());
+
+  // The old snapshot is left as it was.
+  EXPECT_EQ(1, pinned->macros.size());
+  EXPECT_EQ(AST::Symbol("old"),
+            pinned->macros.at(AST::Keyword(":m").AsSymbol())
+            ->body.constants[0]);
+
+  // An invalid library changes nothing.
+  library.clear();
+  library.push_back(ParseOrDie("(defmacro :m (a) (newer ,a))"));
+  library.push_back(ParseOrDie("(defmacro :bad (a) (f ,b))"));
+  EXPECT_EQ(INVALID_MACRO_FORM,
+            engine.Reload(std::move(library)).error_code());
+  EXPECT_EQ(2, engine.size());
+  EXPECT_EQ(ParseOrDie("(new 1)"),
+            engine.Evaluate(ParseOrDie("(:m 1)")).value());
+}
+
+TEST(Macro, ConcurrentReloadTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :m (a) (v0 ,a))")).ok());
+
+  std::atomic<bool> done(false);
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&engine, &done, &mismatches]() {
+      AST first = ParseOrDie("(x (v0 1) (v0 2))");
+      AST second = ParseOrDie("(x (v1 1) (v1 2))");
+      while (!done) {
+        // Both calls expand with the same version of the macro.
+        auto result = engine.Evaluate(ParseOrDie("(x (:m 1) (:m 2))"));
+        if (!result.ok() ||
+            !(result.value() == first || result.value() == second)) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 200; ++i) {
+    std::vector<AST> library;
+    library.push_back(ParseOrDie(
+        i % 2 == 0 ? "(defmacro :m (a) (v1 ,a))" :
+        "(defmacro :m (a) (v0 ,a))"));
+    EXPECT_TRUE(engine.Reload(std::move(library)).ok());
+  }
+  done = true;
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(0, mismatches);
+}
+
+TEST(Macro, SharedEvalTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :plus (a b) (+ ,a ,b))")).ok());
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :laugh () \"haha\")")).ok());
+
+  SharedAstPool pool;
+  for (const char *code : {"(:plus (:plus 12 13) (:plus 11.5 (:laugh)))",
+                           "(I say (:laugh))", "atom", "()"}) {
+    auto result = engine.Evaluate(pool.FromAST(ParseOrDie(code)), &pool);
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(engine.Evaluate(ParseOrDie(code)).value(),
+              result.value().ToAST());
+  }
+
+  EXPECT_EQ(SIGNATURE_MISMATCH,
+            engine.Evaluate(pool.FromAST(ParseOrDie("(:plus 1)")), &pool)
+            .error_code());
+}
+
+TEST(Macro, SharedDuplicatedArgumentTest) {
+  Engine engine;
+  EXPECT_TRUE(engine.Acquire(ParseOrDie(
+      "(defmacro :twice (x) (,x ,x))")).ok());
+
+  // Expands to a complete binary tree of depth 40, which only has 41
+  // distinct subtrees.
+  std::string code = "leaf";
+  for (int i = 0; i < 40; ++i) {
+    code = "(:twice " + code + ")";
+  }
+
+  SharedAstPool pool;
+  auto result = engine.Evaluate(pool.FromAST(ParseOrDie(code)), &pool);
+  ASSERT_TRUE(result.ok());
+
+  SharedAST node = result.value();
+  for (int i = 0; i < 40; ++i) {
+    ASSERT_EQ(AST::LIST, node.type());
+    ASSERT_EQ(2, node.AsVector().size());
+    EXPECT_EQ(node.AsVector()[0], node.AsVector()[1]);
+    node = node.AsVector()[0];
+  }
+  EXPECT_EQ("leaf", node.AsString());
+}
+
 }  // namespace macro
 }  // namespace lisparser
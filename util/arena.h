@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace lisparser {
+namespace util {
+
+// Arena is a bump allocator. Allocations are carved out of large
+// blocks, deallocations are no-ops, and all blocks are released at
+// once when the arena is destroyed. Everything allocated from it must
+// be dead (or at least never touched again) by then.
+class Arena : public std::pmr::monotonic_buffer_resource {
+ public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  explicit Arena(size_t initial_block_size = DEFAULT_BLOCK_SIZE)
+      : std::pmr::monotonic_buffer_resource(initial_block_size) {}
+
+ private:
+  Arena(const Arena&) = delete;
+  const Arena &operator=(const Arena&) = delete;
+};
+
+}  // namespace util
+}  // namespace lisparser
@@ -1,34 +1,99 @@
 #pragma once
 
-#include <cctype>
+#include <array>
+#include <cstdint>
 
 namespace lisparser {
 namespace util {
 namespace char_ops {
 
-inline bool Skipper(int character) {
-  // In the default locale, the whitespace characters are the
-  // following:
-  //
-  // space (0x20, ' ')
-  // form feed (0x0c, '\f')
-  // line feed (0x0a, '\n')
-  // carriage return (0x0d, '\r')
-  // horizontal tab (0x09, '\t')
-  // vertical tab (0x0b, '\v')
-
-  return std::isspace(character);
+// Classes of characters, as far as the tokenizers are concerned. The
+// classification is that of the "C" locale, and does not change with
+// the current locale.
+enum CharClass : uint8_t {
+  // space, horizontal tab, vertical tab and form feed.
+  WHITESPACE = 0,
+  // line feed and carriage return, which also end comments.
+  LINE_END = 1,
+  OPEN_PAREN = 2,
+  CLOSE_PAREN = 3,
+  COMMA = 4,
+  QUOTE = 5,
+  // The following ones are symbol characters, but have a special
+  // meaning in some places.
+  BACKSLASH = 6,
+  SEMICOLON = 7,
+  COLON = 8,
+  DIGIT = 9,
+  DOT = 10,
+  MINUS = 11,
+  UPPER = 12,
+  // Any other symbol character.
+  SYMBOL = 13,
+  // Control characters, non-ASCII bytes and the apostrophe.
+  INVALID = 14,
+  // Pseudo class for the end of the input.
+  END = 15,
+};
+
+constexpr int NUM_CHAR_CLASSES = 16;
+
+namespace internal {
+constexpr CharClass Classify(int character) {
+  if (character == ' ' || character == '\t' ||
+      character == '\v' || character == '\f') return WHITESPACE;
+  if (character == '\n' || character == '\r') return LINE_END;
+  if (character == '(') return OPEN_PAREN;
+  if (character == ')') return CLOSE_PAREN;
+  if (character == ',') return COMMA;
+  if (character == '"') return QUOTE;
+  if (character == '\\') return BACKSLASH;
+  if (character == ';') return SEMICOLON;
+  if (character == ':') return COLON;
+  if (character >= '0' && character <= '9') return DIGIT;
+  if (character == '.') return DOT;
+  if (character == '-') return MINUS;
+  if (character >= 'A' && character <= 'Z') return UPPER;
+  if (character == '\'') return INVALID;
+  if (character > ' ' && character < 0x7f) return SYMBOL;
+  return INVALID;
+}
+
+constexpr std::array<CharClass, 256> MakeClassTable() {
+  std::array<CharClass, 256> table {};
+  for (int i = 0; i < 256; ++i) {
+    table[i] = Classify(i);
+  }
+  return table;
+}
+}  // namespace internal
+
+// Indexed by the character as an unsigned char.
+constexpr std::array<CharClass, 256> CLASS_TABLE =
+    internal::MakeClassTable();
+
+// Accepts EOF as well, like the <cctype> functions.
+constexpr CharClass Classify(int character) {
+  return (character >= 0 && character < 256) ? CLASS_TABLE[character] : END;
+}
+
+constexpr bool Skipper(int character) {
+  CharClass char_class = Classify(character);
+  return char_class == WHITESPACE || char_class == LINE_END;
+}
+
+constexpr bool SymbolCharacter(int character) {
+  CharClass char_class = Classify(character);
+  return char_class >= BACKSLASH && char_class <= SYMBOL;
+}
+
+constexpr bool Digit(int character) {
+  return Classify(character) == DIGIT;
 }
 
-inline bool SymbolCharacter(int character) {
-  return (std::isalpha(character) ||
-          std::isdigit(character) ||
-          (std::ispunct(character) &&
-           static_cast<char>(character) != '(' &&
-           static_cast<char>(character) != ')' &&
-           static_cast<char>(character) != ',' &&
-           static_cast<char>(character) != '\'' &&
-           static_cast<char>(character) != '"'));
+constexpr char ToLower(char character) {
+  return (character >= 'A' && character <= 'Z') ?
+      static_cast<char>(character | 0x20) : character;
 }
 
 }  // namespace char_ops
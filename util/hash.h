@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace lisparser {
+namespace util {
+
+// A fast non-cryptographic 64-bit hash of a buffer (MurmurHash64A),
+// which reads it 8 bytes at a time.
+inline uint64_t Hash64(const char *data, size_t size, uint64_t seed = 0) {
+  constexpr uint64_t MULTIPLIER = 0xc6a4a7935bd1e995ULL;
+  constexpr int SHIFT = 47;
+
+  uint64_t hash = seed ^ (size * MULTIPLIER);
+
+  const char *end = data + (size & ~static_cast<size_t>(7));
+  for (; data != end; data += 8) {
+    uint64_t word;
+    std::memcpy(&word, data, 8);
+    word *= MULTIPLIER;
+    word ^= word >> SHIFT;
+    word *= MULTIPLIER;
+    hash ^= word;
+    hash *= MULTIPLIER;
+  }
+
+  size_t rest = size & 7;
+  if (rest > 0) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < rest; ++i) {
+      word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+          << (8 * i);
+    }
+    hash ^= word;
+    hash *= MULTIPLIER;
+  }
+
+  hash ^= hash >> SHIFT;
+  hash *= MULTIPLIER;
+  hash ^= hash >> SHIFT;
+  return hash;
+}
+
+namespace internal {
+
+inline uint64_t Rotate(uint64_t value, int shift) {
+  return (value << shift) | (value >> (64 - shift));
+}
+
+inline uint64_t Mix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+}  // namespace internal
+
+// A 128-bit hash of a buffer (MurmurHash3_x64_128), for when a 64-bit
+// one collides too easily, e.g. to tell whether two large inputs are
+// the same. It is still not cryptographic.
+inline std::array<uint64_t, 2> Hash128(const char *data, size_t size,
+                                       uint64_t seed = 0) {
+  using internal::Mix;
+  using internal::Rotate;
+  constexpr uint64_t C1 = 0x87c37b91114253d5ULL;
+  constexpr uint64_t C2 = 0x4cf5ad432745937fULL;
+
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+
+  const char *end = data + (size & ~static_cast<size_t>(15));
+  for (; data != end; data += 16) {
+    uint64_t k1, k2;
+    std::memcpy(&k1, data, 8);
+    std::memcpy(&k2, data + 8, 8);
+
+    h1 ^= Rotate(k1 * C1, 31) * C2;
+    h1 = (Rotate(h1, 27) + h2) * 5 + 0x52dce729;
+    h2 ^= Rotate(k2 * C2, 33) * C1;
+    h2 = (Rotate(h2, 31) + h1) * 5 + 0x38495ab5;
+  }
+
+  size_t rest = size & 15;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  for (size_t i = rest; i > 8; --i) {
+    k2 |= static_cast<uint64_t>(static_cast<unsigned char>(data[i - 1]))
+        << (8 * (i - 9));
+  }
+  for (size_t i = rest < 8 ? rest : 8; i > 0; --i) {
+    k1 |= static_cast<uint64_t>(static_cast<unsigned char>(data[i - 1]))
+        << (8 * (i - 1));
+  }
+  if (rest > 8) h2 ^= Rotate(k2 * C2, 33) * C1;
+  if (rest > 0) h1 ^= Rotate(k1 * C1, 31) * C2;
+
+  h1 ^= size;
+  h2 ^= size;
+  h1 += h2;
+  h2 += h1;
+  h1 = Mix(h1);
+  h2 = Mix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
+}  // namespace util
+}  // namespace lisparser
@@ -0,0 +1,66 @@
+#include "util/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lisparser {
+namespace util {
+
+Result<std::shared_ptr<const MappedFile>> MappedFile::Open(
+    const std::string &path) {
+  using ResultType = Result<std::shared_ptr<const MappedFile>>;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ResultType(OPEN_FAILED,
+                      StrCat("cannot open ", path, ": ",
+                             std::strerror(errno)));
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    int error = errno;
+    close(fd);
+    return ResultType(OPEN_FAILED,
+                      StrCat("cannot stat ", path, ": ",
+                             std::strerror(error)));
+  }
+
+  size_t size = static_cast<size_t>(status.st_size);
+
+  // mmap() refuses empty mappings, and an empty file does not need one.
+  if (size == 0) {
+    close(fd);
+    return std::shared_ptr<const MappedFile>(new MappedFile(nullptr, 0));
+  }
+
+  void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  if (address == MAP_FAILED) {
+    return ResultType(MMAP_FAILED,
+                      StrCat("cannot mmap ", path, ": ",
+                             std::strerror(error)));
+  }
+
+  // This is only a hint, so failures are deliberately ignored.
+  madvise(address, size, MADV_SEQUENTIAL);
+
+  return std::shared_ptr<const MappedFile>(
+      new MappedFile(static_cast<const char*>(address), size));
+}
+
+MappedFile::~MappedFile() {
+  if (_data != nullptr) {
+    munmap(const_cast<char*>(_data), _size);
+  }
+}
+
+}  // namespace util
+}  // namespace lisparser
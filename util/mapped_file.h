@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "util/result.h"
+
+namespace lisparser {
+namespace util {
+
+// A read-only memory mapping of a whole file. The mapping is released
+// when the object is destroyed, so hold it through a shared_ptr for as
+// long as anything points into data().
+class MappedFile {
+ public:
+  enum MappedFileError {
+    OPEN_FAILED = 1,
+    MMAP_FAILED = 2,
+  };
+
+  // Maps the file at path and advises the kernel that it is going to
+  // be read sequentially.
+  static Result<std::shared_ptr<const MappedFile>> Open(
+      const std::string &path);
+
+  ~MappedFile();
+
+  inline const char *data() const {
+    return _data;
+  }
+
+  inline size_t size() const {
+    return _size;
+  }
+
+ private:
+  MappedFile(const char *data, size_t size)
+      : _data(data), _size(size) {}
+
+  MappedFile(const MappedFile&) = delete;
+  const MappedFile &operator=(const MappedFile&) = delete;
+
+  const char *_data;
+  size_t _size;
+};
+
+}  // namespace util
+}  // namespace lisparser
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <system_error>
+
+namespace lisparser {
+namespace util {
+namespace number {
+
+// Adds a decimal digit to the magnitude of an integer literal being
+// scanned. Returns false, leaving the magnitude alone, if it would not
+// fit in 64 bits.
+inline bool AppendDigit(uint64_t *magnitude, int digit) {
+  constexpr uint64_t MAX = std::numeric_limits<uint64_t>::max();
+  if (*magnitude > (MAX - digit) / 10) return false;
+  *magnitude = *magnitude * 10 + digit;
+  return true;
+}
+
+// Returns false if the literal does not fit in an int64_t.
+inline bool ToInt64(uint64_t magnitude, bool negative, int64_t *value) {
+  constexpr uint64_t MAX =
+      static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+  if (magnitude > MAX + (negative ? 1 : 0)) return false;
+  *value = negative ? static_cast<int64_t>(0 - magnitude) :
+      static_cast<int64_t>(magnitude);
+  return true;
+}
+
+// Parses an integer literal ([-]digits), and returns false if it is out
+// of range.
+inline bool ParseInteger(std::string_view literal, int64_t *value) {
+  bool negative = !literal.empty() && literal[0] == '-';
+  uint64_t magnitude = 0;
+  for (size_t i = negative ? 1 : 0; i < literal.size(); ++i) {
+    if (!AppendDigit(&magnitude, literal[i] - '0')) return false;
+  }
+  return ToInt64(magnitude, negative, value);
+}
+
+// Parses a float literal ([-]digits.digits, where either side of the dot
+// may be empty), correctly rounded. Returns std::errc::invalid_argument
+// if it has no digits at all (e.g. "-."), and
+// std::errc::result_out_of_range if it is out of the range of double.
+inline std::errc ParseDouble(std::string_view literal, double *value) {
+  const char *end = literal.data() + literal.size();
+  std::from_chars_result result =
+      std::from_chars(literal.data(), end, *value);
+  if (result.ec == std::errc() && result.ptr != end) {
+    return std::errc::invalid_argument;
+  }
+  return result.ec;
+}
+
+}  // namespace number
+}  // namespace util
+}  // namespace lisparser
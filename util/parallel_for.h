@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace lisparser {
+namespace util {
+
+// Runs task(i) for every i in [0, num_tasks) on up to num_threads
+// threads (the calling thread being one of them), and returns when all
+// of them have finished. The other threads are started on every call
+// and joined before returning, there is no persistent pool. Each thread
+// keeps claiming the next task that nobody has started yet from a shared
+// atomic counter, so that a few slow tasks do not leave the others idle.
+template <typename TaskType>
+void ParallelFor(size_t num_tasks, size_t num_threads, const TaskType &task) {
+  num_threads = std::max<size_t>(1, std::min(num_threads, num_tasks));
+
+  std::atomic<size_t> next_task(0);
+  auto work = [&next_task, num_tasks, &task]() {
+    for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+      task(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace util
+}  // namespace lisparser
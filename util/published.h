@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace lisparser {
+namespace util {
+
+namespace internal {
+// Threads announce their reads on one of that many stripes, so that
+// readers on different cores rarely write to the same cache line.
+constexpr size_t NUM_READER_STRIPES = 16;
+
+// The number of readers on a stripe, for even and odd epochs.
+struct alignas(64) ReaderStripe {
+  ReaderStripe() {
+    readers[0].store(0, std::memory_order_relaxed);
+    readers[1].store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> readers[2];
+};
+
+inline size_t ThisThreadStripe() {
+  static std::atomic<size_t> next_stripe(0);
+  thread_local size_t stripe =
+      next_stripe.fetch_add(1, std::memory_order_relaxed) %
+      NUM_READER_STRIPES;
+  return stripe;
+}
+}  // namespace internal
+
+// Published holds an immutable value that many threads read while a
+// few replace it, in the style of read-copy-update. Readers never lock
+// nor touch a reference count: they only bump a counter of their own
+// stripe for the current epoch and load a pointer. Publish() swaps the
+// pointer, moves on to the next epoch and waits for the readers of the
+// previous one before releasing the old value, so that the writer pays
+// for the reclamation and readers never wait.
+template <typename ValueType>
+class Published {
+  // Owns the value. Readers only read the pointer it holds.
+  struct Holder {
+    explicit Holder(std::shared_ptr<const ValueType> &&input_value)
+        : value(std::move(input_value)) {}
+
+    std::shared_ptr<const ValueType> value;
+  };
+
+ public:
+  // Keeps the value that was current when it was created alive, until
+  // it is destroyed. A thread holding a Reader must not call Publish(),
+  // which would wait for it forever.
+  class Reader {
+   public:
+    ~Reader() {
+      _readers->fetch_sub(1, std::memory_order_release);
+    }
+
+    inline const ValueType &operator*() const {
+      return *_holder->value;
+    }
+
+    inline const ValueType *operator->() const {
+      return _holder->value.get();
+    }
+
+    // Shares the ownership of the value, so that it outlives the reader
+    // (and the Published). Unlike reading, this bumps a reference count.
+    inline std::shared_ptr<const ValueType> Share() const {
+      return _holder->value;
+    }
+
+   private:
+    friend class Published;
+
+    Reader(const Published *published, std::atomic<uint64_t> *readers)
+        : _readers(readers),
+          _holder(published->_current.load(std::memory_order_acquire)) {}
+
+    Reader(const Reader&) = delete;
+    const Reader &operator=(const Reader&) = delete;
+
+    std::atomic<uint64_t> *_readers;
+    const Holder *_holder;
+  };
+
+  explicit Published(std::shared_ptr<const ValueType> value)
+      : _current(new Holder(std::move(value))), _epoch(0) {}
+
+  ~Published() {
+    delete _current.load(std::memory_order_relaxed);
+  }
+
+  Reader Read() const {
+    internal::ReaderStripe &stripe =
+        _stripes[internal::ThisThreadStripe()];
+    while (true) {
+      uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+      std::atomic<uint64_t> *readers = &stripe.readers[epoch & 1];
+      readers->fetch_add(1, std::memory_order_seq_cst);
+      // Once the epoch is confirmed, the writer that ends it is bound to
+      // see this reader. Otherwise retry with the new epoch.
+      if (_epoch.load(std::memory_order_seq_cst) == epoch) {
+        return Reader(this, readers);
+      }
+      readers->fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // Replaces the value, and returns once no reader can see the old one.
+  // Writers have to be serialized by the caller.
+  void Publish(std::shared_ptr<const ValueType> value) {
+    const Holder *old = _current.exchange(new Holder(std::move(value)),
+                                          std::memory_order_seq_cst);
+    // Readers of the new epoch can only load the new value.
+    uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+    _epoch.store(epoch + 1, std::memory_order_seq_cst);
+    for (internal::ReaderStripe &stripe : _stripes) {
+      std::atomic<uint64_t> &readers = stripe.readers[epoch & 1];
+      while (readers.load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::yield();
+      }
+    }
+    delete old;
+  }
+
+ private:
+  Published(const Published&) = delete;
+  const Published &operator=(const Published&) = delete;
+
+  std::atomic<const Holder*> _current;
+  std::atomic<uint64_t> _epoch;
+  mutable internal::ReaderStripe _stripes[internal::NUM_READER_STRIPES];
+};
+
+}  // namespace util
+}  // namespace lisparser
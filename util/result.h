@@ -1,8 +1,12 @@
 #pragma once
 
-#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <new>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace lisparser {
 namespace util {
@@ -29,6 +33,10 @@ std::string StrCat(const RestType&... rest) {
   return stream.str();
 }
 
+// Result holds either a value or an error (code and message), stored
+// inline, so that neither a successful nor a failed Result allocates.
+// Error messages given as string literals are kept as pointers, only
+// composed messages are stored as strings.
 template <typename ValueType>
 class Result {
  public:
@@ -36,36 +44,84 @@ class Result {
     OK = 0,
   };
   
-  Result(ValueType &&value)
-      : _value(new ValueType(std::move(value))),
-        _error_code(OK), _error_message() {}
+  Result(ValueType &&value) : _error_code(OK) {
+    new (&_value) ValueType(std::move(value));
+  }
+
+  Result(int error_code) : _error_code(error_code) {
+    assert(error_code != OK);
+    new (&_error) Error(nullptr);
+  }
 
-  Result(int error_code)
-      : _value(nullptr), _error_code(error_code) {}
+  // Only for string literals, or other arrays of static storage
+  // duration, which are kept as pointers rather than copied. Anything
+  // else, e.g. the c_str() of a std::string, has to go through the
+  // std::string overload.
+  template <size_t N>
+  Result(int error_code, const char (&error_message)[N])
+      : _error_code(error_code) {
+    assert(error_code != OK);
+    new (&_error) Error(error_message);
+  }
 
   Result(int error_code, std::string &&error_message) 
-      : _value(nullptr),
-        _error_code(error_code),
-        _error_message(error_message) {}
+      : _error_code(error_code) {
+    assert(error_code != OK);
+    new (&_error) Error(std::move(error_message));
+  }
+
+  Result(Result<ValueType> &&other) : _error_code(other._error_code) {
+    if (ok()) {
+      new (&_value) ValueType(std::move(other._value));
+    } else {
+      new (&_error) Error(std::move(other._error));
+    }
+  }
 
-  Result(Result<ValueType> &&other)
-      : _value(std::move(other._value)),
-        _error_code(other._error_code),
-        _error_message(std::move(other._error_message)) {}
+  // Takes over the error of a failed Result of another type.
+  template <typename OtherType>
+  static Result<ValueType> ErrorFrom(Result<OtherType> &&other) {
+    assert(!other.ok());
+    if (other._error.literal != nullptr) {
+      Result<ValueType> result(other._error_code);
+      result._error.literal = other._error.literal;
+      return result;
+    }
+    return Result<ValueType>(other._error_code,
+                             std::move(other._error.composed));
+  }
 
   Result<ValueType> &operator=(Result<ValueType> &&other) {
-    _value = std::move(other._value);
-    _error_code = other._error_code;
-    _error_message.swap(other._error_message);
+    if (this != &other) {
+      this->~Result();
+      new (this) Result(std::move(other));
+    }
     return *this;
   }
 
+  ~Result() {
+    if (ok()) {
+      _value.~ValueType();
+    } else {
+      _error.~Error();
+    }
+  }
 
   inline bool ok() const {
     return _error_code == OK;
   }
 
-  std::unique_ptr<ValueType> value() {
+  ValueType &value() & {
+    assert(_error_code == OK);
+    return _value;
+  }
+
+  const ValueType &value() const & {
+    assert(_error_code == OK);
+    return _value;
+  }
+
+  ValueType &&value() && {
     assert(_error_code == OK);
     return std::move(_value);
   }
@@ -74,17 +130,35 @@ class Result {
     return _error_code;
   }
 
-  inline const std::string &error_message() const {
-    return _error_message;
+  inline std::string_view error_message() const {
+    if (ok()) return std::string_view();
+    if (_error.literal != nullptr) return _error.literal;
+    return _error.composed;
   }
   
  private:
+  struct Error {
+    explicit Error(const char *input_literal)
+        : literal(input_literal), composed() {}
+
+    explicit Error(std::string &&input_composed)
+        : literal(nullptr), composed(std::move(input_composed)) {}
+
+    const char *literal;
+    std::string composed;
+  };
+
+  template <typename OtherType>
+  friend class Result;
+
   Result(const Result<ValueType> &other) = delete;
   Result<ValueType> &operator=(const Result &other) = delete;
-  
-  std::unique_ptr<ValueType> _value;
+
   int _error_code;
-  std::string _error_message;
+  union {
+    ValueType _value;
+    Error _error;
+  };
 };
 
 }  // namespace util
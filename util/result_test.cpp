@@ -0,0 +1,66 @@
+#include "util/result.h"
+
+#include <memory>
+#include <string>
+#include "gtest/gtest.h"
+
+namespace lisparser {
+namespace util {
+
+TEST(Result, ValueTest) {
+  Result<std::unique_ptr<int>> result(std::unique_ptr<int>(new int(42)));
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(Result<int>::OK, result.error_code());
+  EXPECT_EQ("", result.error_message());
+  EXPECT_EQ(42, *result.value());
+
+  Result<std::unique_ptr<int>> moved = std::move(result);
+  ASSERT_TRUE(moved.ok());
+  std::unique_ptr<int> value = std::move(moved).value();
+  EXPECT_EQ(42, *value);
+}
+
+TEST(Result, ErrorTest) {
+  Result<std::string> literal(3, "some error");
+  EXPECT_FALSE(literal.ok());
+  EXPECT_EQ(3, literal.error_code());
+  EXPECT_EQ("some error", literal.error_message());
+
+  Result<std::string> composed(4, StrCat("error ", 17));
+  EXPECT_EQ(4, composed.error_code());
+  EXPECT_EQ("error 17", composed.error_message());
+
+  // Messages that are not literals are copied, not borrowed.
+  std::string message("temporary error");
+  Result<std::string> copied(6, message.c_str());
+  message.assign("overwritten error");
+  EXPECT_EQ("temporary error", copied.error_message());
+
+  Result<std::string> code_only(5);
+  EXPECT_EQ("", code_only.error_message());
+}
+
+TEST(Result, AssignmentTest) {
+  Result<std::string> result(std::string("value"));
+  result = Result<std::string>(3, StrCat("error ", 17));
+  EXPECT_EQ("error 17", result.error_message());
+
+  result = Result<std::string>(std::string("another value"));
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ("another value", result.value());
+}
+
+TEST(Result, ErrorFromTest) {
+  Result<int> literal =
+      Result<int>::ErrorFrom(Result<std::string>(3, "some error"));
+  EXPECT_EQ(3, literal.error_code());
+  EXPECT_EQ("some error", literal.error_message());
+
+  Result<int> composed =
+      Result<int>::ErrorFrom(Result<std::string>(4, StrCat("error ", 17)));
+  EXPECT_EQ(4, composed.error_code());
+  EXPECT_EQ("error 17", composed.error_message());
+}
+
+}  // namespace util
+}  // namespace lisparser
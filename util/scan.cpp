@@ -0,0 +1,328 @@
+#include "util/scan.h"
+
+// LISPARSER_NO_SIMD_SCAN comes from the CMake option
+// LISPARSER_ENABLE_SIMD_SCAN=OFF, and keeps the scalar kernels only.
+#if defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(LISPARSER_NO_SIMD_SCAN)
+#define LISPARSER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace lisparser {
+namespace util {
+namespace scan {
+
+namespace {
+
+// ---------- Scalar ----------
+
+inline bool IsWhitespace(unsigned char character) {
+  return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+inline bool IsSymbolCharacter(unsigned char character) {
+  return character > ' ' && character < 0x7f &&
+      character != '(' && character != ')' && character != ',' &&
+      character != '\'' && character != '"';
+}
+
+inline bool IsUpper(unsigned char character) {
+  return character >= 'A' && character <= 'Z';
+}
+
+size_t SkipWhitespaceScalar(const char *data, size_t position, size_t size) {
+  while (position < size &&
+         IsWhitespace(static_cast<unsigned char>(data[position]))) {
+    ++position;
+  }
+  return position;
+}
+
+size_t FindSymbolEndScalar(const char *data, size_t position, size_t size,
+                           bool *has_upper) {
+  bool upper = false;
+  while (position < size &&
+         IsSymbolCharacter(static_cast<unsigned char>(data[position]))) {
+    upper |= IsUpper(static_cast<unsigned char>(data[position]));
+    ++position;
+  }
+  *has_upper = upper;
+  return position;
+}
+
+size_t FindQuoteOrBackslashScalar(const char *data, size_t position,
+                                  size_t size) {
+  while (position < size && data[position] != '"' &&
+         data[position] != '\\') {
+    ++position;
+  }
+  return position;
+}
+
+size_t FindLineEndScalar(const char *data, size_t position, size_t size) {
+  while (position < size && data[position] != '\r' &&
+         data[position] != '\n') {
+    ++position;
+  }
+  return position;
+}
+
+void LowerCaseScalar(const char *source, size_t size, char *target) {
+  for (size_t i = 0; i < size; ++i) {
+    unsigned char character = static_cast<unsigned char>(source[i]);
+    target[i] = static_cast<char>(
+        IsUpper(character) ? character | 0x20 : character);
+  }
+}
+
+#ifdef LISPARSER_SCAN_X86
+
+// ---------- SSE2 ----------
+//
+// Bytes are compared as signed integers, which conveniently puts all
+// the non-ASCII bytes below every printable character.
+
+inline __m128i Load16(const char *data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline __m128i InRange16(__m128i chunk, char low, char high) {
+  return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+                       _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+}
+
+inline __m128i Equal16(__m128i chunk, char character) {
+  return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(character));
+}
+
+inline unsigned Mask16(__m128i flags) {
+  return static_cast<unsigned>(_mm_movemask_epi8(flags));
+}
+
+size_t SkipWhitespaceSse2(const char *data, size_t position, size_t size) {
+  for (; position + 16 <= size; position += 16) {
+    __m128i chunk = Load16(data + position);
+    __m128i whitespace = _mm_or_si128(Equal16(chunk, ' '),
+                                      InRange16(chunk, '\t', '\r'));
+    unsigned other = ~Mask16(whitespace) & 0xffff;
+    if (other != 0) return position + __builtin_ctz(other);
+  }
+  return SkipWhitespaceScalar(data, position, size);
+}
+
+size_t FindSymbolEndSse2(const char *data, size_t position, size_t size,
+                         bool *has_upper) {
+  bool upper = false;
+  for (; position + 16 <= size; position += 16) {
+    __m128i chunk = Load16(data + position);
+    __m128i excluded = _mm_or_si128(
+        _mm_or_si128(Equal16(chunk, '('), Equal16(chunk, ')')),
+        _mm_or_si128(_mm_or_si128(Equal16(chunk, ','), Equal16(chunk, '\'')),
+                     Equal16(chunk, '"')));
+    __m128i symbol = _mm_andnot_si128(excluded, InRange16(chunk, '!', '~'));
+    unsigned other = ~Mask16(symbol) & 0xffff;
+    unsigned uppers = Mask16(InRange16(chunk, 'A', 'Z'));
+    if (other != 0) {
+      unsigned offset = __builtin_ctz(other);
+      *has_upper = upper || (uppers & ((1u << offset) - 1)) != 0;
+      return position + offset;
+    }
+    upper |= uppers != 0;
+  }
+  bool tail_upper = false;
+  position = FindSymbolEndScalar(data, position, size, &tail_upper);
+  *has_upper = upper || tail_upper;
+  return position;
+}
+
+size_t FindQuoteOrBackslashSse2(const char *data, size_t position,
+                                size_t size) {
+  for (; position + 16 <= size; position += 16) {
+    __m128i chunk = Load16(data + position);
+    unsigned found = Mask16(_mm_or_si128(Equal16(chunk, '"'),
+                                         Equal16(chunk, '\\')));
+    if (found != 0) return position + __builtin_ctz(found);
+  }
+  return FindQuoteOrBackslashScalar(data, position, size);
+}
+
+size_t FindLineEndSse2(const char *data, size_t position, size_t size) {
+  for (; position + 16 <= size; position += 16) {
+    __m128i chunk = Load16(data + position);
+    unsigned found = Mask16(_mm_or_si128(Equal16(chunk, '\r'),
+                                         Equal16(chunk, '\n')));
+    if (found != 0) return position + __builtin_ctz(found);
+  }
+  return FindLineEndScalar(data, position, size);
+}
+
+void LowerCaseSse2(const char *source, size_t size, char *target) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = Load16(source + i);
+    __m128i bits = _mm_and_si128(InRange16(chunk, 'A', 'Z'),
+                                 _mm_set1_epi8(0x20));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i),
+                     _mm_or_si128(chunk, bits));
+  }
+  LowerCaseScalar(source + i, size - i, target + i);
+}
+
+// ---------- AVX2 ----------
+
+#define LISPARSER_AVX2 __attribute__((target("avx2")))
+
+LISPARSER_AVX2 inline __m256i Load32(const char *data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+LISPARSER_AVX2 inline __m256i InRange32(__m256i chunk, char low, char high) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(low - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chunk));
+}
+
+LISPARSER_AVX2 inline __m256i Equal32(__m256i chunk, char character) {
+  return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(character));
+}
+
+LISPARSER_AVX2 inline unsigned Mask32(__m256i flags) {
+  return static_cast<unsigned>(_mm256_movemask_epi8(flags));
+}
+
+LISPARSER_AVX2
+size_t SkipWhitespaceAvx2(const char *data, size_t position, size_t size) {
+  for (; position + 32 <= size; position += 32) {
+    __m256i chunk = Load32(data + position);
+    __m256i whitespace = _mm256_or_si256(Equal32(chunk, ' '),
+                                         InRange32(chunk, '\t', '\r'));
+    unsigned other = ~Mask32(whitespace);
+    if (other != 0) return position + __builtin_ctz(other);
+  }
+  return SkipWhitespaceSse2(data, position, size);
+}
+
+LISPARSER_AVX2
+size_t FindSymbolEndAvx2(const char *data, size_t position, size_t size,
+                         bool *has_upper) {
+  bool upper = false;
+  for (; position + 32 <= size; position += 32) {
+    __m256i chunk = Load32(data + position);
+    __m256i excluded = _mm256_or_si256(
+        _mm256_or_si256(Equal32(chunk, '('), Equal32(chunk, ')')),
+        _mm256_or_si256(
+            _mm256_or_si256(Equal32(chunk, ','), Equal32(chunk, '\'')),
+            Equal32(chunk, '"')));
+    __m256i symbol = _mm256_andnot_si256(excluded,
+                                         InRange32(chunk, '!', '~'));
+    unsigned other = ~Mask32(symbol);
+    unsigned uppers = Mask32(InRange32(chunk, 'A', 'Z'));
+    if (other != 0) {
+      unsigned offset = __builtin_ctz(other);
+      unsigned before = offset == 0 ? 0 : (~0u >> (32 - offset));
+      *has_upper = upper || (uppers & before) != 0;
+      return position + offset;
+    }
+    upper |= uppers != 0;
+  }
+  bool tail_upper = false;
+  position = FindSymbolEndSse2(data, position, size, &tail_upper);
+  *has_upper = upper || tail_upper;
+  return position;
+}
+
+LISPARSER_AVX2
+size_t FindQuoteOrBackslashAvx2(const char *data, size_t position,
+                                size_t size) {
+  for (; position + 32 <= size; position += 32) {
+    __m256i chunk = Load32(data + position);
+    unsigned found = Mask32(_mm256_or_si256(Equal32(chunk, '"'),
+                                            Equal32(chunk, '\\')));
+    if (found != 0) return position + __builtin_ctz(found);
+  }
+  return FindQuoteOrBackslashSse2(data, position, size);
+}
+
+LISPARSER_AVX2
+size_t FindLineEndAvx2(const char *data, size_t position, size_t size) {
+  for (; position + 32 <= size; position += 32) {
+    __m256i chunk = Load32(data + position);
+    unsigned found = Mask32(_mm256_or_si256(Equal32(chunk, '\r'),
+                                            Equal32(chunk, '\n')));
+    if (found != 0) return position + __builtin_ctz(found);
+  }
+  return FindLineEndSse2(data, position, size);
+}
+
+LISPARSER_AVX2
+void LowerCaseAvx2(const char *source, size_t size, char *target) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i chunk = Load32(source + i);
+    __m256i bits = _mm256_and_si256(InRange32(chunk, 'A', 'Z'),
+                                    _mm256_set1_epi8(0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i),
+                        _mm256_or_si256(chunk, bits));
+  }
+  LowerCaseSse2(source + i, size - i, target + i);
+}
+
+#undef LISPARSER_AVX2
+
+#endif  // LISPARSER_SCAN_X86
+
+}  // namespace
+
+const Kernels &ScalarKernels() {
+  static const Kernels kernels = {
+    &SkipWhitespaceScalar,
+    &FindSymbolEndScalar,
+    &FindQuoteOrBackslashScalar,
+    &FindLineEndScalar,
+    &LowerCaseScalar,
+  };
+  return kernels;
+}
+
+const Kernels *Sse2Kernels() {
+#ifdef LISPARSER_SCAN_X86
+  // SSE2 is part of the x86-64 baseline.
+  static const Kernels kernels = {
+    &SkipWhitespaceSse2,
+    &FindSymbolEndSse2,
+    &FindQuoteOrBackslashSse2,
+    &FindLineEndSse2,
+    &LowerCaseSse2,
+  };
+  return &kernels;
+#else
+  return nullptr;
+#endif
+}
+
+const Kernels *Avx2Kernels() {
+#ifdef LISPARSER_SCAN_X86
+  static const Kernels kernels = {
+    &SkipWhitespaceAvx2,
+    &FindSymbolEndAvx2,
+    &FindQuoteOrBackslashAvx2,
+    &FindLineEndAvx2,
+    &LowerCaseAvx2,
+  };
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported ? &kernels : nullptr;
+#else
+  return nullptr;
+#endif
+}
+
+const Kernels &BestKernels() {
+  static const Kernels *best =
+      Avx2Kernels() != nullptr ? Avx2Kernels() :
+      Sse2Kernels() != nullptr ? Sse2Kernels() : &ScalarKernels();
+  return *best;
+}
+
+}  // namespace scan
+}  // namespace util
+}  // namespace lisparser
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lisparser {
+namespace util {
+namespace scan {
+
+// Bulk scanning kernels for contiguous buffers. Each kernel has a
+// scalar implementation and, on x86-64, SSE2 and AVX2 implementations
+// that are selected at runtime. All of them classify characters as the
+// "C" locale does, whatever the current locale is.
+struct Kernels {
+  // Returns the position of the first non-whitespace character at or
+  // after position, or size.
+  size_t (*skip_whitespace)(const char *data, size_t position, size_t size);
+
+  // Returns the end of the run of symbol characters starting at
+  // position, and whether there is any upper case letter in the run.
+  size_t (*find_symbol_end)(const char *data, size_t position, size_t size,
+                            bool *has_upper);
+
+  // Returns the position of the first '"' or '\\' at or after
+  // position, or size.
+  size_t (*find_quote_or_backslash)(const char *data, size_t position,
+                                    size_t size);
+
+  // Returns the position of the first '\r' or '\n' at or after
+  // position, or size.
+  size_t (*find_line_end)(const char *data, size_t position, size_t size);
+
+  // Copies size characters from source to target, lower casing the
+  // ASCII letters.
+  void (*lower_case)(const char *source, size_t size, char *target);
+};
+
+const Kernels &ScalarKernels();
+
+// Return nullptr when the CPU (or the target) does not support them.
+const Kernels *Sse2Kernels();
+const Kernels *Avx2Kernels();
+
+// The best kernels supported by the CPU.
+const Kernels &BestKernels();
+
+inline size_t SkipWhitespace(const char *data, size_t position,
+                             size_t size) {
+  return BestKernels().skip_whitespace(data, position, size);
+}
+
+inline size_t FindSymbolEnd(const char *data, size_t position, size_t size,
+                            bool *has_upper) {
+  return BestKernels().find_symbol_end(data, position, size, has_upper);
+}
+
+inline size_t FindQuoteOrBackslash(const char *data, size_t position,
+                                   size_t size) {
+  return BestKernels().find_quote_or_backslash(data, position, size);
+}
+
+inline size_t FindLineEnd(const char *data, size_t position, size_t size) {
+  return BestKernels().find_line_end(data, position, size);
+}
+
+inline void LowerCase(const char *source, size_t size, char *target) {
+  BestKernels().lower_case(source, size, target);
+}
+
+}  // namespace scan
+}  // namespace util
+}  // namespace lisparser
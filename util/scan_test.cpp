@@ -0,0 +1,104 @@
+#include "util/scan.h"
+
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace lisparser {
+namespace util {
+namespace scan {
+
+namespace {
+std::vector<const Kernels*> VectorizedKernels() {
+  std::vector<const Kernels*> result;
+  if (Sse2Kernels() != nullptr) result.push_back(Sse2Kernels());
+  if (Avx2Kernels() != nullptr) result.push_back(Avx2Kernels());
+  return result;
+}
+
+// Random strings drawn from an alphabet that makes every kernel stop
+// at interesting places, with lengths around the vector widths.
+std::vector<std::string> RandomInputs() {
+  const std::string alphabet =
+      "  \t\n\r\v\fabcXYZ09-:;.\"\\(),'~!\x01\x7f\x80\xff";
+  std::mt19937 engine(3115);
+  std::vector<std::string> inputs;
+  for (size_t length = 0; length < 100; ++length) {
+    for (int repeat = 0; repeat < 20; ++repeat) {
+      std::string input;
+      // Make long runs of the same class likely.
+      std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+      char run_character = alphabet[pick(engine)];
+      for (size_t i = 0; i < length; ++i) {
+        input.push_back(engine() % 8 == 0 ?
+                        alphabet[pick(engine)] : run_character);
+      }
+      inputs.push_back(input);
+    }
+  }
+  return inputs;
+}
+}  // namespace
+
+TEST(Scan, ScalarTest) {
+  const Kernels &scalar = ScalarKernels();
+  std::string code = " \t\n Abc-D;(x \"a\\b\"\n";
+
+  EXPECT_EQ(4, scalar.skip_whitespace(code.data(), 0, code.size()));
+  bool has_upper = false;
+  EXPECT_EQ(10, scalar.find_symbol_end(code.data(), 4, code.size(),
+                                       &has_upper));
+  EXPECT_TRUE(has_upper);
+  EXPECT_EQ(12, scalar.find_symbol_end(code.data(), 11, code.size(),
+                                       &has_upper));
+  EXPECT_FALSE(has_upper);
+  EXPECT_EQ(13, scalar.find_quote_or_backslash(code.data(), 0,
+                                               code.size()));
+  EXPECT_EQ(15, scalar.find_quote_or_backslash(code.data(), 14,
+                                               code.size()));
+  EXPECT_EQ(2, scalar.find_line_end(code.data(), 0, code.size()));
+  EXPECT_EQ(18, scalar.find_line_end(code.data(), 3, code.size()));
+
+  char lowered[7];
+  scalar.lower_case("Abc-D;", 7, lowered);
+  EXPECT_EQ(std::string("abc-d;"), lowered);
+}
+
+TEST(Scan, VectorizedMatchesScalarTest) {
+  const Kernels &scalar = ScalarKernels();
+
+  for (const Kernels *kernels : VectorizedKernels()) {
+    for (const std::string &input : RandomInputs()) {
+      const char *data = input.data();
+      size_t size = input.size();
+      for (size_t position = 0; position <= size; ++position) {
+        EXPECT_EQ(scalar.skip_whitespace(data, position, size),
+                  kernels->skip_whitespace(data, position, size));
+
+        bool expected_upper = false;
+        bool actual_upper = true;
+        EXPECT_EQ(scalar.find_symbol_end(data, position, size,
+                                         &expected_upper),
+                  kernels->find_symbol_end(data, position, size,
+                                           &actual_upper));
+        EXPECT_EQ(expected_upper, actual_upper);
+
+        EXPECT_EQ(scalar.find_quote_or_backslash(data, position, size),
+                  kernels->find_quote_or_backslash(data, position, size));
+        EXPECT_EQ(scalar.find_line_end(data, position, size),
+                  kernels->find_line_end(data, position, size));
+      }
+
+      std::string expected(size, '\0');
+      std::string actual(size, '\0');
+      scalar.lower_case(data, size, &expected[0]);
+      kernels->lower_case(data, size, &actual[0]);
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+}  // namespace scan
+}  // namespace util
+}  // namespace lisparser